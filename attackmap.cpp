@@ -0,0 +1,163 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2022 The Stockfish developers (see AUTHORS file)
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstring>   // For std::memset, std::memcmp
+
+#include "attackmap.h"
+#include "position.h"
+
+namespace Stockfish {
+
+namespace {
+
+  Bitboard piece_attacks(const Position& pos, Piece pc, Square s) {
+
+    return type_of(pc) == PAWN ? pawn_attacks_bb(color_of(pc), s)
+                               : attacks_bb(type_of(pc), s, pos.pieces());
+  }
+
+} // namespace
+
+
+/// AttackMap::add() and AttackMap::remove() count one more or one less
+/// attacker of color c on the squares of b, keeping the union in sync.
+
+void AttackMap::add(Color c, Bitboard b) {
+
+  byColor[c] |= b;
+  while (nonemptyBB(b))
+      ++count[c][pop_lsb(b)];
+}
+
+void AttackMap::remove(Color c, Bitboard b) {
+
+  while (nonemptyBB(b))
+  {
+      Square s = pop_lsb(b);
+      assert(count[c][s]);
+      if (!--count[c][s])
+          byColor[c] ^= s;
+  }
+}
+
+
+/// AttackMap::compute() builds the map from scratch, looping over every piece
+
+void AttackMap::compute(const Position& pos) {
+
+  std::memset(this, 0, sizeof(AttackMap));
+
+  Bitboard b = pos.pieces();
+  while (nonemptyBB(b))
+  {
+      Square s = pop_lsb(b);
+      Piece pc = pos.piece_on(s);
+
+      attacks[s] = piece_attacks(pos, pc, s);
+      owners[color_of(pc)] |= s;
+      add(color_of(pc), attacks[s]);
+  }
+}
+
+
+/// AttackMap::update() brings the map in sync with pos after the squares in
+/// 'changed' have been emptied, filled or had their piece replaced. Besides
+/// the pieces on those squares, only a slider whose ray reached a changed
+/// square can see its attacks change: a square in between that was occupied
+/// would itself be a changed square reached by the same ray. Candidates are
+/// sliders on a line through a changed square, kept if their stored attacks
+/// include it. Called with the same squares after undo_move(), it restores
+/// the previous map.
+
+void AttackMap::update(const Position& pos, Bitboard changed) {
+
+  Bitboard affected = changed;
+  Bitboard sliders = (pos.pieces(BISHOP, ROOK) | pos.pieces(QUEEN)) & ~changed;
+  Bitboard b = changed;
+
+  while (nonemptyBB(b))
+  {
+      Square c = pop_lsb(b);
+      Bitboard candidates = sliders & attacks_bb<QUEEN>(c) & ~affected;
+
+      while (nonemptyBB(candidates))
+      {
+          Square s = pop_lsb(candidates);
+          if (nonemptyBB(attacks[s] & c))
+              affected |= s;
+      }
+  }
+
+  while (nonemptyBB(affected))
+  {
+      Square s = pop_lsb(affected);
+      Piece pc = pos.piece_on(s);
+      Bitboard oldAttacks = attacks[s];
+      Bitboard newAttacks = pc != NO_PIECE ? piece_attacks(pos, pc, s) : NoSquares;
+
+      if (pc != NO_PIECE && nonemptyBB(owners[color_of(pc)] & s))
+      {
+          // Same owner as before, only the difference needs counting
+          remove(color_of(pc), oldAttacks & ~newAttacks);
+          add(color_of(pc), newAttacks & ~oldAttacks);
+      }
+      else
+      {
+          for (Color c : { WHITE, BLACK })
+              if (nonemptyBB(owners[c] & s))
+              {
+                  remove(c, oldAttacks);
+                  owners[c] ^= s;
+              }
+
+          if (pc != NO_PIECE)
+          {
+              add(color_of(pc), newAttacks);
+              owners[color_of(pc)] |= s;
+          }
+      }
+
+      attacks[s] = newAttacks;
+  }
+}
+
+
+/// AttackMap::attacked_by() returns the squares attacked by the pieces of the
+/// given color and type. It only ORs stored attack sets, no slider is walked.
+
+Bitboard AttackMap::attacked_by(const Position& pos, Color c, PieceType pt) const {
+
+  Bitboard attacked = NoSquares;
+  Bitboard b = pos.pieces(c, pt);
+
+  while (nonemptyBB(b))
+      attacked |= attacks[pop_lsb(b)];
+
+  return attacked;
+}
+
+
+bool AttackMap::operator==(const AttackMap& m) const {
+
+  for (Square s = SQ_A1; s <= SQ_P16; ++s)
+      if (attacks[s] != m.attacks[s])
+          return false;
+
+  return   byColor[WHITE] == m.byColor[WHITE] && byColor[BLACK] == m.byColor[BLACK]
+        && owners[WHITE] == m.owners[WHITE] && owners[BLACK] == m.owners[BLACK]
+        && !std::memcmp(count, m.count, sizeof(count));
+}
+
+} // namespace Stockfish
@@ -0,0 +1,55 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2022 The Stockfish developers (see AUTHORS file)
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ATTACKMAP_H_INCLUDED
+#define ATTACKMAP_H_INCLUDED
+
+#include "types.h"
+
+namespace Stockfish {
+
+class Position;
+
+/// AttackMap holds the attacks of every piece on the board, the number of
+/// attackers of each color on every square and the union of the squares
+/// attacked by each color. compute() builds it from scratch, update() only
+/// regenerates the pieces standing on the changed squares and the sliders
+/// whose rays reached one of them, which is all a move can affect.
+
+class AttackMap {
+public:
+  void compute(const Position& pos);
+  void update(const Position& pos, Bitboard changed);
+
+  Bitboard attacks_from(Square s) const { return attacks[s]; }
+  Bitboard attacked_by(Color c) const { return byColor[c]; }
+  Bitboard attacked_by(const Position& pos, Color c, PieceType pt) const;
+  int attackers_count(Color c, Square s) const { return count[c][s]; }
+
+  bool operator==(const AttackMap& m) const;
+
+private:
+  void add(Color c, Bitboard b);
+  void remove(Color c, Bitboard b);
+
+  Bitboard attacks[SQUARE_NB];
+  Bitboard byColor[COLOR_NB];
+  Bitboard owners[COLOR_NB]; // Squares whose attacks[] are counted for each color
+  uint8_t count[COLOR_NB][SQUARE_NB];
+};
+
+} // namespace Stockfish
+
+#endif // #ifndef ATTACKMAP_H_INCLUDED
@@ -0,0 +1,573 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2022 The Stockfish developers (see AUTHORS file)
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+
+#include "benchmark.h"
+#include "bitboard.h"
+#include "evaluate.h"
+#include "geometry.h"
+#include "movegen.h"
+#include "perf.h"
+#include "position.h"
+#include "search.h"
+#include "summarybb.h"
+#include "thread.h"
+#include "tt.h"
+#include "uci.h"
+
+namespace Stockfish {
+
+namespace {
+
+  // Positions of the end-to-end bench: the start position, then positions
+  // every 25 plies of self-play games at depth 3 after 10 random plies.
+  const std::vector<std::string> Defaults = {
+    StartFEN,
+    "rn2rnbqkbnrqb1r/p4p1p1pp2p1p/2p12n/1p2p3p2pp1p1/16/16/16/16/16/16/16/11B4/2PP7P2b1/11R3N/PP2PPPPPPP1PP1P/RNBQRNBQKBN4R b - 1 13",
+    "rn2r1b1k1nr3r/p4p1p1pp4p/2p10p1n/1p2p3p2pp1p1/7n8/16/3b12/5q3b6/5b9R/16/16/14N1/2PP7PP3/P1N13/1P2PPPPPPP2P1P/R1B1RNBQKBN4R w - 0 26",
+    "rn2r1b1k1n4r/p9p5/2p7p2p2/1p2pp1p3pp2p/7n1p4p1/16/3b12/9b6/16/13N2/16/16/2PPP4P1PP2P/P1N4BP7/1P3PPP2P2P2/R3RNB1K1N4R b - 0 38",
+    "rn2r3k1n4r/10p5/2p10p2/1p2pp4p4p/p6npp1p2p1/12p3/3b12/16/11N4/5b2B7/16/3N1P10/1PPPP4PPPPP1P/P5N1P7/6PP8/R3R3K1N4R w - 0 51",
+    "r1bqrnbqk2r1bnr/ppppppppp3p2p/n8B3p2/7n2pp2p1/16/1q14/16/16/14Q1/16/16/1P14/8P7/B1N2Pb2PP5/P1PPP2P3PPPPP/R2QRN2KBNRQBNR b - 0 13",
+    "r1b1r1b1k2r1bnr/ppp2pRpn3p2p/n5n2p3Q2/3pp5pp2p1/16/1q14/16/16/3q5B6/16/16/1P11B2/8P3P3/2N2P3Pq5/P1PPP2N3P1PPP/R5Q1K1NRQBNR w - 0 26",
+    "r1b1r1k2r3bnr/p4p2n4B2/n5n2p3p2/1pppp2p2p3pp/16/16/11R4/16/9B6/6q9/16/1P11B2/4P1N1P3P1PP/2N2P3PP1Q3/P1PP9P2/7RK1N3NR b - 0 38",
+    "4rk3r3bnr/4n3n7/3Qp8p2/3pp4pp3pp/1p5p8/16/16/7B8/16/16/16/1P14/P3P1N1P3P1PP/2N2P3P6/2Pq9P2/7R1KN3NR w - 4 51",
+    "rnb1rnb1kbnr1b2/pppp1ppp1pp1pp1r/8pq1p1npp/4p11/16/1q14/16/16/16/7B8/9Q6/16/1P6P3P3/P1N2QPP7N/2PPPP3PPP1PPP/R1BQRNB1KBNR3R b - 0 13",
+    "rnb1rnb1k1nr1b2/ppp2p1p1pp1pp1r/8p4npp/3pp1p4p4/5b10/16/16/16/6B9/16/16/10B5/1P2P3P1PPPPP1/P1N3PP7N/2PP1P3P5P/R1B1RN2KBNR2R1 w - 0 26",
+    "rn2rn2k1nr4/10p2p1r/2p2p2pp3npp/pp1pp1pp3pp3/16/16/5B10/8b7/6B3b5/4b11/7B8/3NP6PP3/1P1P1PP1P1P2PP1/P6P7N/2P6P5P/R3RN2K1NR2R1 b - 1 38",
+    "rn3n2k1nr4/13p1r/2p2p3p4pp/1p4ppp1ppp3/p2p8n3/15r/1b1Bp6B4/16/4B2b2b5/16/12P3/3NP3P2P4/1PPP1PP2PP2PP1/P6P6RN/4R3N6P/R4N2K2R4 w - 1 51",
+    "rnb1rnb1k1nrqbnr/pp1p1ppp1ppp1ppp/12p3/6q1p7/4p11/16/16/2b13/16/12q3/14Q1/16/4P6PP3/8P7/PPPP1PPP1PP1BPPP/RNBQRNBQKBNR2NR b - 4 13",
+    "rn2r1b1k1nr1b1r/pp3ppp1pp3pp/6n6nq1/3p4p2ppp2/16/4p11/3b9Q2/10B5/10b5/16/16/16/3PP6PP3/8P7/PPP2PPP1PP1BPPP/RN2RNB1KBNR2NR w - 2 26",
+    "rnR3b1k1nr3r/pp4pp1p4pp/5p7n2/3p4p2pp3/16/4pn2q7/3b12/16/10Q5/16/16/16/3PP6PP3/8P5P1/Pr3PPP1PP1BP1P/RN3NB1K1NR2NR b - 1 38",
+    "rn1R2bk7r/1p4p1np6/3Q1p7n2/8p2pp1pp/p6p8/4pn10/3b3q8/16/16/1r14/9Br5/10P5/P2PPP3P1PP2P/8P5P1/6PP4BP2/RN3N2K1NR2NR w - 0 51",
+  };
+
+  // Size of the input arrays, a power of two. Inputs are drawn once from a
+  // fixed seed so that every build and machine measures the same work.
+  constexpr int InputSize = 4096;
+
+  struct Inputs {
+    std::vector<Square> from, to;
+    std::vector<Bitboard> occupied;
+  };
+
+  Inputs make_inputs() {
+
+    PRNG rng(1070372);
+    Inputs in;
+
+    for (int i = 0; i < InputSize; ++i)
+    {
+        in.from.push_back(Square(rng.rand<unsigned>() % SQUARE_NB));
+        in.to.push_back(Square(rng.rand<unsigned>() % SQUARE_NB));
+        in.occupied.push_back(rng.sparse_rand()); // About 32 pieces on the board
+    }
+    return in;
+  }
+
+  inline uint64_t fold(Bitboard b) { return b.b[0] ^ b.b[1] ^ b.b[2] ^ b.b[3]; }
+
+  // The same kernel on a board of any geometry: the king moves of a set of
+  // pieces by shifts, then the population count. Inputs are the low squares
+  // of the 16x16 occupancies, so every word width does the same work per
+  // square and the timings show the cost of the word itself.
+  template<int Files, int Ranks>
+  void geometry_phase(std::ostream& os, const Inputs& in, int iterations) {
+
+    using G = Geometry<Files, Ranks>;
+    using GB = typename G::Bitboard;
+
+    std::vector<GB> sets;
+    for (const Bitboard& b : in.occupied)
+    {
+        GB g = G::NoSquares;
+        for (int s = 0; s < G::SQUARE_NB; ++s)
+            if (b.b[s / 64] & (1ULL << (s % 64)))
+                g |= G::square_bb(typename G::Square(s));
+        sets.push_back(g);
+    }
+
+    const std::string name =  "Geometry " + std::to_string(Files) + "x" + std::to_string(Ranks)
+                            + " (" + std::to_string(8 * sizeof(GB)) + " bits)";
+
+    run_phase(os, name.c_str(), uint64_t(iterations) * InputSize, [&]() {
+        uint64_t sum = 0;
+        for (int it = 0; it < iterations; ++it)
+            for (const GB& b : sets)
+            {
+                GB k = G::template shift<G::EAST>(b) | G::template shift<G::WEST>(b);
+                k |= b;
+                k |= G::template shift<G::NORTH>(k) | G::template shift<G::SOUTH>(k);
+                sum += Words::popcount(k & ~b);
+            }
+        return sum;
+    });
+  }
+
+  // A game of pseudo-random legal moves from the start position, the same for
+  // every build. Each ply keeps the position after the move and the squares
+  // the move changed, which is what AttackMap::update() needs.
+  struct GamePly {
+    Position pos;
+    Bitboard changed;
+  };
+
+  std::vector<GamePly> make_game(std::deque<StateInfo>& states, int maxPly) {
+
+    PRNG rng(1070372);
+    std::vector<GamePly> game;
+    Position pos;
+
+    states.emplace_back();
+    pos.set(StartFEN, &states.back());
+    game.push_back({ pos, NoSquares });
+
+    for (int ply = 0; ply < maxPly; ++ply)
+    {
+        MoveList<LEGAL> moves(pos);
+        if (!moves.size())
+            break;
+
+        Move m = *(moves.begin() + rng.rand<unsigned>() % moves.size());
+        Square capsq = type_of(m) == EN_PASSANT ? to_sq(m) - pawn_push(pos.side_to_move()) : to_sq(m);
+
+        states.emplace_back();
+        pos.do_move(m, states.back());
+        game.push_back({ pos, from_sq(m) | to_sq(m) | capsq });
+    }
+    return game;
+  }
+
+  uint64_t perft(Position& pos, int depth) {
+
+    StateInfo st;
+    uint64_t nodes = 0;
+
+    for (const auto& m : MoveList<LEGAL>(pos))
+    {
+        if (depth <= 1)
+            ++nodes;
+        else
+        {
+            pos.do_move(m, st);
+            nodes += perft(pos, depth - 1);
+            pos.undo_move(m);
+        }
+    }
+    return nodes;
+  }
+
+  // scan() is the kernel of the piece set phases, the scans that move
+  // generation and evaluation run on the sets of a position.
+  template<typename BB>
+  uint64_t scan(BB b) {
+    uint64_t sum = popcount(b) + more_than_one(b);
+    if (!b.empty())
+        sum += lsb(b) ^ (msb(b) << 8);
+    while (!b.empty())
+        sum += pop_lsb(b);
+    return sum;
+  }
+
+  // Plain bitboards get empty() so that scan() reads the same for both
+  struct PlainBitboard {
+    Bitboard bb;
+    bool empty() const { return !nonemptyBB(bb); }
+  };
+
+  inline int    popcount(PlainBitboard b)      { return Stockfish::popcount(b.bb); }
+  inline bool   more_than_one(PlainBitboard b) { return Stockfish::more_than_one(b.bb); }
+  inline Square lsb(PlainBitboard b)           { return Stockfish::lsb(b.bb); }
+  inline Square msb(PlainBitboard b)           { return Stockfish::msb(b.bb); }
+  inline Square pop_lsb(PlainBitboard& b)      { return Stockfish::pop_lsb(b.bb); }
+
+  // run_phase() times f(), which must return a checksum of its results so
+  // the work is not optimized away, and prints the figures for the phase.
+  template<typename F>
+  void run_phase(std::ostream& os, const char* name, uint64_t ops, F f) {
+
+    PerfCounters perf;
+
+    auto start = std::chrono::steady_clock::now();
+    perf.start();
+    uint64_t checksum = f();
+    perf.stop();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    double ns = double(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+
+    os << name << ": " << ops << " ops, " << std::fixed << std::setprecision(2)
+       << ns / ops << " ns/op (checksum " << std::hex << checksum << std::dec << ")\n";
+
+    perf.report(os, ops);
+  }
+
+} // namespace
+
+
+namespace Benchmark {
+
+void micro(std::ostream& os, int iterations) {
+
+  const Inputs in = make_inputs();
+  const uint64_t ops = uint64_t(iterations) * InputSize;
+
+  // Compare the lookup phases across builds with -DFOLDED_TABLES=0/1/2
+  os << "Geometry tables: " << sizeof(BitboardTables) / 1024 << " KB (FOLDED_TABLES="
+     << FOLDED_TABLES << ")\n";
+
+  run_phase(os, "Rook attacks", ops, [&]() {
+      uint64_t sum = 0;
+      for (int it = 0; it < iterations; ++it)
+          for (int i = 0; i < InputSize; ++i)
+              sum += fold(attacks_bb<ROOK>(in.from[i], in.occupied[i]));
+      return sum;
+  });
+
+  run_phase(os, "Bishop attacks", ops, [&]() {
+      uint64_t sum = 0;
+      for (int it = 0; it < iterations; ++it)
+          for (int i = 0; i < InputSize; ++i)
+              sum += fold(attacks_bb<BISHOP>(in.from[i], in.occupied[i]));
+      return sum;
+  });
+
+  run_phase(os, "PseudoAttacks", ops, [&]() {
+      uint64_t sum = 0;
+      for (int it = 0; it < iterations; ++it)
+          for (int i = 0; i < InputSize; ++i)
+              sum += fold(attacks_bb<KNIGHT>(in.from[i]) | attacks_bb<KING>(in.to[i]));
+      return sum;
+  });
+
+  run_phase(os, "BetweenBB/LineBB", ops, [&]() {
+      uint64_t sum = 0;
+      for (int it = 0; it < iterations; ++it)
+          for (int i = 0; i < InputSize; ++i)
+              sum += fold(between_bb(in.from[i], in.to[i]) ^ line_bb(in.from[i], in.to[i]));
+      return sum;
+  });
+
+  run_phase(os, "pop_lsb", ops, [&]() {
+      uint64_t sum = 0;
+      for (int it = 0; it < iterations; ++it)
+          for (int i = 0; i < InputSize; ++i)
+          {
+              Bitboard b = in.occupied[i];
+              while (nonemptyBB(b))
+                  sum += pop_lsb(b);
+          }
+      return sum;
+  });
+
+  run_phase(os, "popcount", ops, [&]() {
+      uint64_t sum = 0;
+      for (int it = 0; it < iterations; ++it)
+          for (int i = 0; i < InputSize; ++i)
+              sum += popcount(in.occupied[i]) + more_than_one(in.occupied[i] & in.from[i]);
+      return sum;
+  });
+
+  // Board geometries, each with its narrowest word (see BitboardWord)
+  geometry_phase< 8,  8>(os, in, iterations);
+  geometry_phase<10, 10>(os, in, iterations);
+  geometry_phase<12, 12>(os, in, iterations);
+  geometry_phase<16, 16>(os, in, iterations);
+
+  // Attack maps along a game, rebuilt from scratch versus updated from the
+  // previous ply. Both runs must end on the same map.
+  std::deque<StateInfo> states;
+  const std::vector<GamePly> game = make_game(states, 256);
+  const uint64_t plies = uint64_t(iterations) * (game.size() - 1);
+  AttackMap full, incremental;
+
+  run_phase(os, "Attack map full", plies, [&]() {
+      uint64_t sum = 0;
+      for (int it = 0; it < iterations; ++it)
+          for (size_t i = 1; i < game.size(); ++i)
+          {
+              full.compute(game[i].pos);
+              sum += fold(full.attacked_by(WHITE) ^ full.attacked_by(BLACK));
+          }
+      return sum;
+  });
+
+  run_phase(os, "Attack map incremental", plies, [&]() {
+      uint64_t sum = 0;
+      for (int it = 0; it < iterations; ++it)
+      {
+          incremental.compute(game[0].pos);
+          for (size_t i = 1; i < game.size(); ++i)
+          {
+              incremental.update(game[i].pos, game[i].changed);
+              sum += fold(incremental.attacked_by(WHITE) ^ incremental.attacked_by(BLACK));
+          }
+      }
+      return sum;
+  });
+
+  if (!(full == incremental))
+      os << "Attack map mismatch after " << game.size() - 1 << " plies" << std::endl;
+
+  // Static evaluations of the positions of the game, one at a time versus
+  // by blocks with the batched path. Both runs must return the same values.
+  std::vector<const Position*> positions;
+  std::vector<Value> single(game.size() - 1), batched(game.size() - 1);
+
+  for (size_t i = 1; i < game.size(); ++i)
+      positions.push_back(&game[i].pos);
+
+  run_phase(os, "Eval per position", plies, [&]() {
+      uint64_t sum = 0;
+      for (int it = 0; it < iterations; ++it)
+          for (size_t i = 0; i < positions.size(); ++i)
+              sum += uint64_t(single[i] = Eval::evaluate(*positions[i]));
+      return sum;
+  });
+
+  run_phase(os, "Eval batched", plies, [&]() {
+      uint64_t sum = 0;
+      for (int it = 0; it < iterations; ++it)
+      {
+          Eval::evaluate(positions.data(), positions.size(), batched.data());
+          for (Value v : batched)
+              sum += uint64_t(v);
+      }
+      return sum;
+  });
+
+  if (single != batched)
+      os << "Batched evaluation mismatch" << std::endl;
+
+  // The piece sets of the game, by color and type, plus the color and the
+  // occupied sets, scanned as plain and as summary-tagged bitboards. The
+  // tags are computed once, as a position would keep them up to date.
+  std::vector<PlainBitboard> plainSets;
+  std::vector<SummaryBitboard> summarySets;
+  int limbs[5] = {};
+
+  for (size_t i = 1; i < game.size(); ++i)
+  {
+      const Position& pos = game[i].pos;
+      std::vector<Bitboard> sets = { pos.pieces() };
+
+      for (Color c : { WHITE, BLACK })
+      {
+          sets.push_back(pos.pieces(c));
+          for (PieceType pt = PAWN; pt <= KING; ++pt)
+              sets.push_back(pos.pieces(c, pt));
+      }
+
+      for (const Bitboard& b : sets)
+      {
+          plainSets.push_back({ b });
+          summarySets.push_back(b);
+          limbs[summarySets.back().limbs()]++;
+      }
+  }
+
+  os << "Piece sets by non-zero words (0-4):";
+  for (int n : limbs)
+      os << " " << n;
+  os << "\n";
+
+  const uint64_t sets = uint64_t(iterations) * plainSets.size();
+
+  run_phase(os, "Piece sets plain", sets, [&]() {
+      uint64_t sum = 0;
+      for (int it = 0; it < iterations; ++it)
+          for (const PlainBitboard& b : plainSets)
+              sum += scan(b);
+      return sum;
+  });
+
+  run_phase(os, "Piece sets summary", sets, [&]() {
+      uint64_t sum = 0;
+      for (int it = 0; it < iterations; ++it)
+          for (const SummaryBitboard& b : summarySets)
+              sum += scan(b);
+      return sum;
+  });
+
+  // Squares attacked by all the sliders of each color, piece by piece versus
+  // with the setwise occluded fills. Checksums must match.
+  run_phase(os, "Color slider attacks loop", plies, [&]() {
+      uint64_t sum = 0;
+      for (int it = 0; it < iterations; ++it)
+          for (size_t i = 1; i < game.size(); ++i)
+          {
+              const Position& pos = game[i].pos;
+              for (Color c : { WHITE, BLACK })
+              {
+                  Bitboard attacks = NoSquares;
+                  Bitboard b = pos.pieces(c, ROOK, QUEEN);
+                  while (nonemptyBB(b))
+                      attacks |= attacks_bb<ROOK>(pop_lsb(b), pos.pieces());
+                  b = pos.pieces(c, BISHOP, QUEEN);
+                  while (nonemptyBB(b))
+                      attacks |= attacks_bb<BISHOP>(pop_lsb(b), pos.pieces());
+                  sum += fold(attacks);
+              }
+          }
+      return sum;
+  });
+
+  run_phase(os, "Color slider attacks setwise", plies, [&]() {
+      uint64_t sum = 0;
+      for (int it = 0; it < iterations; ++it)
+          for (size_t i = 1; i < game.size(); ++i)
+          {
+              const Position& pos = game[i].pos;
+              for (Color c : { WHITE, BLACK })
+                  sum += fold(  setwise_attacks<ROOK  >(pos.pieces(c, ROOK, QUEEN), pos.pieces())
+                              | setwise_attacks<BISHOP>(pos.pieces(c, BISHOP, QUEEN), pos.pieces()));
+          }
+      return sum;
+  });
+
+  os << std::flush;
+}
+
+
+/// Benchmark::bench() searches each position with the same limit, after one
+/// clear of the hash table, and prints the total node count. With a single
+/// thread the positions run in order and the count is a signature of the
+/// search: any functional change alters it, and builds that search alike
+/// print the same count on every machine. More threads search several
+/// positions at once, sharing the hash table, and the count then varies.
+
+void bench(std::ostream& os, const Options& options) {
+
+  std::vector<std::string> fens;
+
+  if (options.fenFile.empty())
+      fens = Defaults;
+  else
+  {
+      std::ifstream file(options.fenFile);
+      std::string fen;
+
+      if (!file)
+      {
+          os << "Unable to open file " << options.fenFile << std::endl;
+          return;
+      }
+
+      while (std::getline(file, fen))
+          if (!fen.empty())
+          {
+              if (Position::valid_fen(fen))
+                  fens.push_back(fen);
+              else
+                  os << "Skipping invalid fen: " << fen << "\n";
+          }
+  }
+
+  Search::LimitsType limits;
+  limits.depth = options.nodes ? 0 : options.depth;
+  limits.nodes = options.nodes;
+
+  std::vector<Search::Result> results(fens.size());
+  std::atomic<bool> stop{false};
+  ThreadPool pool;
+
+  // Opened before the pool is set, so that they count its workers
+  PerfCounters perf(true);
+
+  TT.resize(options.hashMb);
+  TT.clear();
+  pool.set(options.threads, fens.size());
+
+  TimePoint elapsed = now();
+  perf.start();
+
+  for (size_t i = 0; i < fens.size(); ++i)
+      pool.submit([&, i]() {
+          StateInfo st;
+          Position pos;
+          pos.set(fens[i], &st);
+          results[i] = Search::search(pos, limits, stop);
+      });
+
+  pool.wait_for_idle();
+  perf.stop();
+  elapsed = now() - elapsed + 1; // Ensure positivity to avoid a 'divide by zero'
+
+  uint64_t nodes = 0, cutoffs[PICK_STAGE_NB] = {}, totalCutoffs = 0;
+
+  for (size_t i = 0; i < fens.size(); ++i)
+  {
+      const Search::Result& r = results[i];
+      for (int s = 0; s < PICK_STAGE_NB; ++s)
+          cutoffs[s] += r.cutoffs[s], totalCutoffs += r.cutoffs[s];
+      os << "Position " << i + 1 << "/" << fens.size() << ": bestmove " << UCI::move(r.bestMove)
+         << " score " << (r.bestMove ? UCI::value(r.score) : "none")
+         << " depth " << r.depth << " nodes " << r.nodes << "\n";
+      nodes += r.nodes;
+  }
+
+  os << "\n==========================="
+     << "\nTotal time (ms) : " << elapsed
+     << "\nNodes searched  : " << nodes
+     << "\nNodes/second    : " << 1000 * nodes / elapsed << "\n";
+
+  perf.report(os, nodes);
+
+  // Which stage of the move picker produced the beta cutoffs
+  const char* StageNames[PICK_STAGE_NB] = { "TT", "good captures", "killers", "countermoves",
+                                            "quiets", "bad captures", "evasions" };
+
+  os << "Cutoffs by stage:";
+  for (int s = 0; s < PICK_STAGE_NB; ++s)
+      os << (s ? ", " : " ") << StageNames[s] << " " << std::fixed << std::setprecision(1)
+         << 100.0 * cutoffs[s] / std::max(totalCutoffs, uint64_t(1)) << "%";
+  os << " of " << totalCutoffs << "\n";
+
+  if (options.threads > 1)
+      os << "(" << options.threads << " threads, the node count is not reproducible)\n";
+
+  os << std::flush;
+}
+
+
+void perft(std::ostream& os, const std::string& fen, int depth) {
+
+  StateInfo st;
+  Position pos;
+  pos.set(fen, &st);
+
+  PerfCounters perf;
+
+  TimePoint elapsed = now();
+  perf.start();
+  uint64_t nodes = Stockfish::perft(pos, depth);
+  perf.stop();
+  elapsed = now() - elapsed + 1; // Ensure positivity to avoid a 'divide by zero'
+
+  os << "Nodes searched: " << nodes
+     << "\nNodes/second  : " << 1000 * nodes / elapsed << "\n";
+
+  perf.report(os, nodes);
+  os << std::flush;
+}
+
+} // namespace Benchmark
+
+} // namespace Stockfish
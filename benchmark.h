@@ -0,0 +1,58 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2022 The Stockfish developers (see AUTHORS file)
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BENCHMARK_H_INCLUDED
+#define BENCHMARK_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#include "types.h"
+
+namespace Stockfish {
+
+namespace Benchmark {
+
+/// micro() runs the microbenchmarks of the bitboard primitives, each one as a
+/// separate phase reporting ns/op and, when available, hardware counters.
+
+void micro(std::ostream& os, int iterations);
+
+/// bench() is the end-to-end benchmark: it searches a fixed set of positions,
+/// built in or read from a file with one FEN per line, and prints the node
+/// count, which identifies the search, with the time and the speed.
+
+struct Options {
+  size_t threads = 1;
+  size_t hashMb = 16;
+  Depth depth = 4;
+  uint64_t nodes = 0;  // Replaces the depth limit when not zero
+  std::string fenFile; // Empty for the built-in positions
+};
+
+void bench(std::ostream& os, const Options& options);
+
+/// perft() counts the leaf nodes of the legal move tree of the given depth,
+/// printing the count, the speed and the hardware counters.
+
+void perft(std::ostream& os, const std::string& fen, int depth);
+
+} // namespace Benchmark
+
+} // namespace Stockfish
+
+#endif // #ifndef BENCHMARK_H_INCLUDED
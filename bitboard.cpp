@@ -23,21 +23,12 @@ namespace Stockfish
 {
 
 uint8_t PopCnt16[1 << 16];
-uint8_t SquareDistance[SQUARE_NB][SQUARE_NB];
 
-Bitboard LineBB[SQUARE_NB][SQUARE_NB];
-Bitboard BetweenBB[SQUARE_NB][SQUARE_NB];
-Bitboard PseudoAttacks[PIECE_TYPE_NB][SQUARE_NB];
-Bitboard PawnAttacks[COLOR_NB][SQUARE_NB];
+BitboardTables Tables;
 
-/// safe_destination() returns the bitboard of target square for the given step
-/// from the given square. If the step is off the board, returns empty bitboard.
-
-inline Bitboard safe_destination(Square s, int step)
-{
-    Square to = Square(s + step);
-    return is_ok(to) && (distance(s, to) <= 2) ? square_bb(to) : NoSquares;
-}
+#if defined(USE_NUMA)
+thread_local const BitboardTables* LocalTables = &Tables;
+#endif
 
 /// Bitboards::pretty() returns an ASCII representation of a bitboard suitable
 /// to be printed to standard output. Useful for debugging.
@@ -64,74 +55,53 @@ std::string Bitboards::pretty(const Bitboard b)
 namespace Bitboards {
 
 Bitboard RookAttacks(Square s, Bitboard occupied) {
-    Bitboard attacks = NoSquares;
-    Direction RookDirections[4] = {NORTH, SOUTH, EAST, WEST};
-
-    for (Direction d : RookDirections)
-    {
-        Square sq = s;
-        while (nonemptyBB(safe_destination(sq, d)) && !(nonemptyBB(occupied & square_bb(sq))))
-            attacks |= square_bb(sq += d);
-    }
-    return attacks;
+    INSTRUMENT_COUNT(ROOK_ATTACKS);
+    INSTRUMENT_SCOPE(SLIDER_TIMER);
+    return Board::sliding_attacks<ROOK>(Board::Square(s), occupied);
 }
 
 Bitboard BishopAttacks(Square s, Bitboard occupied) {
-    Bitboard attacks = NoSquares;
-    Direction RookDirections[4] = {NORTH_EAST, SOUTH_EAST, SOUTH_WEST, NORTH_WEST};
-
-    for (Direction d : RookDirections)
-    {
-        Square sq = s;
-        while (nonemptyBB(safe_destination(sq, d)) && !(nonemptyBB(occupied & square_bb(sq))))
-            attacks |= square_bb(sq += d);
-    }
-    return attacks;
+    INSTRUMENT_COUNT(BISHOP_ATTACKS);
+    INSTRUMENT_SCOPE(SLIDER_TIMER);
+    return Board::sliding_attacks<BISHOP>(Board::Square(s), occupied);
 }
 
 void init()
 {
+    INSTRUMENT_SCOPE(INIT_TIMER);
 
     for (unsigned i = 0; i < (1 << 16); ++i)
         PopCnt16[i] = uint8_t(std::bitset<16>(i).count());
 
+#if !FOLDED_TABLES
     for (Square s1 = SQ_A1; s1 <= SQ_P16; ++s1)
+    {
+        Tables.PawnAttacks[WHITE][s1] = Board::pawn_attacks(WHITE, Board::Square(s1));
+        Tables.PawnAttacks[BLACK][s1] = Board::pawn_attacks(BLACK, Board::Square(s1));
+
         for (Square s2 = SQ_A1; s2 <= SQ_P16; ++s2)
-            SquareDistance[s1][s2] = std::max(distance<File>(s1, s2), distance<Rank>(s1, s2));
+            Tables.SquareDistance[s1][s2] = uint8_t(Board::distance(Board::Square(s1), Board::Square(s2)));
+    }
+#endif
 
+    // Only the squares of the stored part of the board, the others are
+    // reconstructed by the lookups (see fold_mask()). The entries themselves
+    // come from the builders of Geometry, shared with the other board sizes.
     for (Square s1 = SQ_A1; s1 <= SQ_P16; ++s1)
     {
-        PawnAttacks[WHITE][s1] = pawn_attacks_bb<WHITE>(square_bb(s1));
-        PawnAttacks[BLACK][s1] = pawn_attacks_bb<BLACK>(square_bb(s1));
-
-        for (int step :
-                {
-                    -17, -16, -15, -1, 1, 15, 16, 17
-                    } )
-                        PseudoAttacks[KING][s1] |= safe_destination(s1, step);
-
-        for (int step :
-                {
-                    -33, -31, -18, -14, 14, 18, 31, 33
-                    } )
-                        PseudoAttacks[KNIGHT][s1] |= safe_destination(s1, step);
-
-        PseudoAttacks[QUEEN][s1]  = PseudoAttacks[BISHOP][s1] = attacks_bb<BISHOP>(s1, NoSquares);
-        PseudoAttacks[QUEEN][s1] |= PseudoAttacks[  ROOK][s1] = attacks_bb<  ROOK>(s1, NoSquares);
-
-        for (PieceType pt :
-                {
-                    BISHOP, ROOK
-                })
-            for (Square s2 = SQ_A1; s2 <= SQ_P16; ++s2)
-            {
-                if (nonemptyBB(PseudoAttacks[pt][s1] & s2))
-                {
-                    LineBB[s1][s2]    = (attacks_bb(pt, s1, NoSquares) & attacks_bb(pt, s2, NoSquares)) | s1 | s2;
-                    BetweenBB[s1][s2] = (attacks_bb(pt, s1, square_bb(s2)) & attacks_bb(pt, s2, square_bb(s1)));
-                }
-                BetweenBB[s1][s2] |= s2;
-            }
+        if (fold_mask(s1))
+            continue;
+
+        const int i = fold_index(s1);
+
+        for (PieceType pt : { KNIGHT, BISHOP, ROOK, QUEEN, KING })
+            Tables.PseudoAttacks[pt][i] = Board::pseudo_attacks(pt, Board::Square(s1));
+
+        for (Square s2 = SQ_A1; s2 <= SQ_P16; ++s2)
+        {
+            Tables.LineBB[i][s2]    = Board::line(Board::Square(s1), Board::Square(s2));
+            Tables.BetweenBB[i][s2] = Board::between(Board::Square(s1), Board::Square(s2));
+        }
     }
 }
 
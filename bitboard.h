@@ -17,8 +17,14 @@
 #define BITBOARD_H_INCLUDED
 
 #include <string>
+#include "geometry.h"
+#include "misc.h"
 #include "types.h"
 
+#if defined(USE_AVX2)
+#include <immintrin.h>
+#endif
+
 namespace Stockfish {
 
 namespace Bitboards {
@@ -28,68 +34,157 @@ std::string pretty(const Bitboard b);
 
 }
 
-inline bool getBit(Bitboard bb, int f, int r) {
-    return ((bb.b[r >> 2] >> ((r & 3) << 4)) & (1 << f));
+inline bool nonemptyBB(Bitboard bb) {
+    return Words::any(bb);
 }
 
-inline bool nonemptyBB(Bitboard bb) {
-    return (bb.b[0] | bb.b[1] | bb.b[2] | bb.b[3]);
-}
-
-constexpr Bitboard NoSquares = {.b = {0ULL, 0ULL, 0ULL, 0ULL}};
-constexpr Bitboard AllSquares = ~NoSquares;
-constexpr Bitboard DarkSquares = {.b = {0xAAAA5555AAAA5555ULL, 0xAAAA5555AAAA5555ULL, 0xAAAA5555AAAA5555ULL, 0xAAAA5555AAAA5555ULL}};
-constexpr Bitboard LightSquares = ~DarkSquares;
-
-constexpr Bitboard FileABB = {.b = {0x0001000100010001ULL, 0x0001000100010001ULL, 0x0001000100010001ULL, 0x0001000100010001ULL}};
-constexpr Bitboard FileBBB = {.b = {FileABB.b[0]<<1, FileABB.b[1]<<1, FileABB.b[2]<<1, FileABB.b[3]<<1}};
-constexpr Bitboard FileCBB = {.b = {FileABB.b[0]<<2, FileABB.b[1]<<2, FileABB.b[2]<<2, FileABB.b[3]<<2}};
-constexpr Bitboard FileDBB = {.b = {FileABB.b[0]<<3, FileABB.b[1]<<3, FileABB.b[2]<<3, FileABB.b[3]<<3}};
-constexpr Bitboard FileEBB = {.b = {FileABB.b[0]<<4, FileABB.b[1]<<4, FileABB.b[2]<<4, FileABB.b[3]<<4}};
-constexpr Bitboard FileFBB = {.b = {FileABB.b[0]<<5, FileABB.b[1]<<5, FileABB.b[2]<<5, FileABB.b[3]<<5}};
-constexpr Bitboard FileGBB = {.b = {FileABB.b[0]<<6, FileABB.b[1]<<6, FileABB.b[2]<<6, FileABB.b[3]<<6}};
-constexpr Bitboard FileHBB = {.b = {FileABB.b[0]<<7, FileABB.b[1]<<7, FileABB.b[2]<<7, FileABB.b[3]<<7}};
-constexpr Bitboard FileIBB = {.b = {FileABB.b[0]<<8, FileABB.b[1]<<8, FileABB.b[2]<<8, FileABB.b[3]<<8}};
-constexpr Bitboard FileJBB = {.b = {FileABB.b[0]<<9, FileABB.b[1]<<9, FileABB.b[2]<<9, FileABB.b[3]<<9}};
-constexpr Bitboard FileKBB = {.b = {FileABB.b[0]<<10, FileABB.b[1]<<10, FileABB.b[2]<<10, FileABB.b[3]<<10}};
-constexpr Bitboard FileLBB = {.b = {FileABB.b[0]<<11, FileABB.b[1]<<11, FileABB.b[2]<<11, FileABB.b[3]<<11}};
-constexpr Bitboard FileMBB = {.b = {FileABB.b[0]<<12, FileABB.b[1]<<12, FileABB.b[2]<<12, FileABB.b[3]<<12}};
-constexpr Bitboard FileNBB = {.b = {FileABB.b[0]<<13, FileABB.b[1]<<13, FileABB.b[2]<<13, FileABB.b[3]<<13}};
-constexpr Bitboard FileOBB = {.b = {FileABB.b[0]<<14, FileABB.b[1]<<14, FileABB.b[2]<<14, FileABB.b[3]<<14}};
-constexpr Bitboard FilePBB = {.b = {FileABB.b[0]<<15, FileABB.b[1]<<15, FileABB.b[2]<<15, FileABB.b[3]<<15}};
-
-constexpr Bitboard Rank1BB  = {.b = {0xFFFFULL, 0, 0, 0}};
-constexpr Bitboard Rank2BB  = {.b = {0xFFFFULL << (16*1), 0, 0, 0}};
-constexpr Bitboard Rank3BB  = {.b = {0xFFFFULL << (16*2), 0, 0, 0}};
-constexpr Bitboard Rank4BB  = {.b = {0xFFFFULL << (16*3), 0, 0, 0}};
-constexpr Bitboard Rank5BB  = {.b = {0, 0xFFFFULL, 0, 0}};
-constexpr Bitboard Rank6BB  = {.b = {0, 0xFFFFULL << (16*1), 0, 0}};
-constexpr Bitboard Rank7BB  = {.b = {0, 0xFFFFULL << (16*2), 0, 0}};
-constexpr Bitboard Rank8BB  = {.b = {0, 0xFFFFULL << (16*3), 0, 0}};
-constexpr Bitboard Rank9BB  = {.b = {0, 0, 0xFFFFFULL, 0}};
-constexpr Bitboard Rank10BB = {.b = {0, 0, 0xFFFFULL << (16*1), 0}};
-constexpr Bitboard Rank11BB = {.b = {0, 0, 0xFFFFULL << (16*2), 0}};
-constexpr Bitboard Rank12BB = {.b = {0, 0, 0xFFFFULL << (16*3), 0}};
-constexpr Bitboard Rank13BB = {.b = {0, 0, 0, 0xFFFFULL}};
-constexpr Bitboard Rank14BB = {.b = {0, 0, 0, 0xFFFFULL << (16*1)}};
-constexpr Bitboard Rank15BB = {.b = {0, 0, 0, 0xFFFFULL << (16*2)}};
-constexpr Bitboard Rank16BB = {.b = {0, 0, 0, 0xFFFFULL << (16*3)}};
+inline bool getBit(Bitboard bb, int f, int r) {
+    return nonemptyBB(bb & Board::square_bb(Board::make_square(Board::File(f), Board::Rank(r))));
+}
+
+constexpr Bitboard NoSquares = Board::NoSquares;
+constexpr Bitboard AllSquares = Board::AllSquares;
+constexpr Bitboard DarkSquares = Board::DarkSquares;
+constexpr Bitboard LightSquares = AllSquares & ~DarkSquares;
+
+constexpr Bitboard FileABB = Board::FileABB;
+constexpr Bitboard FileBBB = Board::file_bb(Board::File(1));
+constexpr Bitboard FileCBB = Board::file_bb(Board::File(2));
+constexpr Bitboard FileDBB = Board::file_bb(Board::File(3));
+constexpr Bitboard FileEBB = Board::file_bb(Board::File(4));
+constexpr Bitboard FileFBB = Board::file_bb(Board::File(5));
+constexpr Bitboard FileGBB = Board::file_bb(Board::File(6));
+constexpr Bitboard FileHBB = Board::file_bb(Board::File(7));
+constexpr Bitboard FileIBB = Board::file_bb(Board::File(8));
+constexpr Bitboard FileJBB = Board::file_bb(Board::File(9));
+constexpr Bitboard FileKBB = Board::file_bb(Board::File(10));
+constexpr Bitboard FileLBB = Board::file_bb(Board::File(11));
+constexpr Bitboard FileMBB = Board::file_bb(Board::File(12));
+constexpr Bitboard FileNBB = Board::file_bb(Board::File(13));
+constexpr Bitboard FileOBB = Board::file_bb(Board::File(14));
+constexpr Bitboard FilePBB = Board::file_bb(Board::File(15));
+
+constexpr Bitboard Rank1BB  = Board::Rank1BB;
+constexpr Bitboard Rank2BB  = Board::rank_bb(Board::Rank(1));
+constexpr Bitboard Rank3BB  = Board::rank_bb(Board::Rank(2));
+constexpr Bitboard Rank4BB  = Board::rank_bb(Board::Rank(3));
+constexpr Bitboard Rank5BB  = Board::rank_bb(Board::Rank(4));
+constexpr Bitboard Rank6BB  = Board::rank_bb(Board::Rank(5));
+constexpr Bitboard Rank7BB  = Board::rank_bb(Board::Rank(6));
+constexpr Bitboard Rank8BB  = Board::rank_bb(Board::Rank(7));
+constexpr Bitboard Rank9BB  = Board::rank_bb(Board::Rank(8));
+constexpr Bitboard Rank10BB = Board::rank_bb(Board::Rank(9));
+constexpr Bitboard Rank11BB = Board::rank_bb(Board::Rank(10));
+constexpr Bitboard Rank12BB = Board::rank_bb(Board::Rank(11));
+constexpr Bitboard Rank13BB = Board::rank_bb(Board::Rank(12));
+constexpr Bitboard Rank14BB = Board::rank_bb(Board::Rank(13));
+constexpr Bitboard Rank15BB = Board::rank_bb(Board::Rank(14));
+constexpr Bitboard Rank16BB = Board::rank_bb(Board::Rank(15));
 
 extern uint8_t PopCnt16[1 << 16];
-extern uint8_t SquareDistance[SQUARE_NB][SQUARE_NB];
 
-extern Bitboard BetweenBB[SQUARE_NB][SQUARE_NB];
-extern Bitboard LineBB[SQUARE_NB][SQUARE_NB];
-extern Bitboard PseudoAttacks[PIECE_TYPE_NB][SQUARE_NB];
-extern Bitboard PawnAttacks[COLOR_NB][SQUARE_NB];
+/// FOLDED_TABLES selects how much of the board the geometry tables store,
+/// trading a few instructions per lookup for memory:
+///
+///   0  every square (default), about 4.2 MB
+///   1  ranks 1-8 only, mirrored with a byte swap, about 2 MB
+///   2  files A-H of ranks 1-8 only, mirrored with a byte swap and a bit
+///      reversal, about 1 MB
+///
+/// Folded builds also drop SquareDistance and PawnAttacks, which are cheaper
+/// to compute than to load.
+
+#ifndef FOLDED_TABLES
+#define FOLDED_TABLES 0
+#endif
+
+static_assert(FOLDED_TABLES >= 0 && FOLDED_TABLES <= 2, "FOLDED_TABLES must be 0, 1 or 2");
+
+constexpr int FOLDED_SQUARE_NB = SQUARE_NB >> FOLDED_TABLES;
+
+/// fold_mask() returns the flips, as an xor mask on the square index, that
+/// bring s into the stored part of the board, and fold_index() the table
+/// index of a square in that part.
+
+constexpr int fold_mask(Square s) {
+  return (FOLDED_TABLES >= 1 && rank_of(s) >= RANK_9 ? int(SQ_A16) : 0)
+       | (FOLDED_TABLES >= 2 && file_of(s) >= FILE_I ? int(SQ_P1)  : 0);
+}
+
+constexpr int fold_index(Square s) {
+  return FOLDED_TABLES == 2 ? (rank_of(s) << 3) | file_of(s) : int(s);
+}
+
+/// BitboardTables gathers the read-only tables computed by Bitboards::init().
+/// With USE_NUMA every node gets its own copy (see numa.h) and each thread
+/// reads the one of the node it is bound to through LocalTables.
+
+struct BitboardTables {
+#if !FOLDED_TABLES
+  uint8_t  SquareDistance[SQUARE_NB][SQUARE_NB];
+  Bitboard PawnAttacks[COLOR_NB][SQUARE_NB];
+#endif
+  Bitboard BetweenBB[FOLDED_SQUARE_NB][SQUARE_NB];
+  Bitboard LineBB[FOLDED_SQUARE_NB][SQUARE_NB];
+  Bitboard PseudoAttacks[PIECE_TYPE_NB][FOLDED_SQUARE_NB];
+};
+
+extern BitboardTables Tables;
+
+#if defined(USE_NUMA)
+extern thread_local const BitboardTables* LocalTables;
+
+inline const BitboardTables& tables() { return *LocalTables; }
+#else
+inline const BitboardTables& tables() { return Tables; }
+#endif
 
 
 inline Bitboard square_bb(Square s) {
   assert(is_ok(s));
-  unsigned int r = s >> 4, f = s & 0xF;
-  Bitboard bb = {.b {0, 0, 0, 0}};
-  bb.b[r >> 2] = 1ULL << (((r & 3) << 4) | f);
-  return bb;
+  return Board::square_bb(Board::Square(s));
+}
+
+/// flip_rank() and flip_file() mirror a whole bitboard, like their Square
+/// counterparts in types.h. A rank is a 16-bit lane, so flip_rank() reverses
+/// the order of the lanes (reversed words, each byte swapped and its byte
+/// pairs swapped back) and flip_file() reverses the bits inside every lane.
+
+constexpr uint64_t flip_rank(uint64_t x) {
+  x = __builtin_bswap64(x);
+  return ((x >> 8) & 0x00FF00FF00FF00FFULL) | ((x & 0x00FF00FF00FF00FFULL) << 8);
+}
+
+constexpr uint64_t flip_file(uint64_t x) {
+  x = ((x >> 1) & 0x5555555555555555ULL) | ((x & 0x5555555555555555ULL) << 1);
+  x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+  x = ((x >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((x & 0x0F0F0F0F0F0F0F0FULL) << 4);
+  return ((x >> 8) & 0x00FF00FF00FF00FFULL) | ((x & 0x00FF00FF00FF00FFULL) << 8);
+}
+
+// The lanes of the words must be whole ranks, only folded tables need this
+static_assert(!FOLDED_TABLES || (BOARD_FILES == 16 && SQUARE_NB % 64 == 0),
+              "Folded tables need 16-file ranks in whole 64-bit words");
+
+constexpr Bitboard flip_rank(Bitboard b) {
+  constexpr int N = SQUARE_NB / 64;
+  return Bitboard::generate([&](int i) { return flip_rank(b.b[N - 1 - i]); });
+}
+
+constexpr Bitboard flip_file(Bitboard b) {
+  return Bitboard::generate([&](int i) { return flip_file(b.b[i]); });
+}
+
+/// unfold() maps a stored table entry back to the square it was looked up
+/// for, given the fold_mask() of that square. Without folding the mask is
+/// the constant 0 and the call compiles away.
+
+inline Bitboard unfold(Bitboard b, int mask) {
+  if (mask & SQ_A16)
+      b = flip_rank(b);
+  if (mask & SQ_P1)
+      b = flip_file(b);
+  return b;
 }
 
 /// Overloads of bitwise operators between a Bitboard and a Square for testing
@@ -108,16 +203,11 @@ inline Bitboard  operator^(Square s, Bitboard b) { return b ^ s; }
 inline Bitboard  operator|(Square s1, Square s2) { return square_bb(s1) | s2; }
 
 constexpr bool inline more_than_one_b64(uint64_t x) {
-    return x & (x - 1);
+    return Words::more_than_one(x);
 }
 
 constexpr bool more_than_one(Bitboard b) {
-    if (more_than_one_b64(b.b[0])) return true;
-    if (more_than_one_b64(b.b[1])) return true;
-    if (more_than_one_b64(b.b[2])) return true;
-    if (more_than_one_b64(b.b[3])) return true;
-    unsigned int t = ((b.b[0] ? 1 : 0) << 3) | ((b.b[1] ? 1 : 0) << 2) | ((b.b[2] ? 1 : 0) << 1) | (b.b[3] ? 1 : 0);
-    return (t & (t - 1));
+    return Words::more_than_one(b);
 }
 
 constexpr bool opposite_colors(Square s1, Square s2) {
@@ -128,9 +218,7 @@ constexpr bool opposite_colors(Square s1, Square s2) {
 /// the given file or rank.
 
 constexpr Bitboard rank_bb(Rank r) {
-    Bitboard b = NoSquares;
-    b.b[r >> 2] = 0xFFFFULL << ((r & 3) << 4);
-    return b;
+  return Board::rank_bb(Board::Rank(r));
 }
 
 constexpr Bitboard rank_bb(Square s) {
@@ -138,7 +226,7 @@ constexpr Bitboard rank_bb(Square s) {
 }
 
 constexpr Bitboard file_bb(File f) {
-  return {.b = {FileABB.b[0]<<f, FileABB.b[1]<<f, FileABB.b[2]<<f, FileABB.b[3]<<f}};
+  return Board::file_bb(Board::File(f));
 }
 
 constexpr Bitboard file_bb(Square s) {
@@ -146,15 +234,11 @@ constexpr Bitboard file_bb(Square s) {
 }
 
 /// shift() moves a bitboard one or two steps as specified by the direction D
+/// (see Geometry::shift())
 
 template<Direction D>
 constexpr Bitboard shift(Bitboard b) {
-  return  D == NORTH      ?  b             <<16 : D == SOUTH      ?  b             >>16
-        : D == NORTH+NORTH?  b             <<32 : D == SOUTH+SOUTH?  b             >>32
-        : D == EAST       ? (b & ~FilePBB) << 1 : D == WEST       ? (b & ~FileABB) >> 1
-        : D == NORTH_EAST ? (b & ~FilePBB) <<17 : D == NORTH_WEST ? (b & ~FileABB) <<15
-        : D == SOUTH_EAST ? (b & ~FilePBB) >>15 : D == SOUTH_WEST ? (b & ~FileABB) >>17
-        : NoSquares;
+  return Board::shift<static_cast<Board::Direction>(D)>(b);
 }
 
 /// pawn_attacks_bb() returns the squares attacked by pawns of the given color
@@ -168,7 +252,11 @@ constexpr Bitboard pawn_attacks_bb(Bitboard b) {
 
 inline Bitboard pawn_attacks_bb(Color c, Square s) {
   assert(is_ok(s));
-  return PawnAttacks[c][s];
+#if FOLDED_TABLES
+  return c == WHITE ? pawn_attacks_bb<WHITE>(square_bb(s)) : pawn_attacks_bb<BLACK>(square_bb(s));
+#else
+  return tables().PawnAttacks[c][s];
+#endif
 }
 
 /// pawn_double_attacks_bb() returns the squares doubly attacked by pawns of the
@@ -180,6 +268,20 @@ constexpr Bitboard pawn_double_attacks_bb(Bitboard b) {
                     : shift<SOUTH_WEST>(b) & shift<SOUTH_EAST>(b);
 }
 
+/// pawn_pushes_bb() and pawn_double_pushes_bb() return the destinations of
+/// the single and double pushes of the pawns of the given color in the given
+/// bitboard. Double pushes start from the second rank.
+
+template<Color C>
+constexpr Bitboard pawn_pushes_bb(Bitboard pawns, Bitboard empty) {
+  return shift<pawn_push(C)>(pawns) & empty;
+}
+
+template<Color C>
+constexpr Bitboard pawn_double_pushes_bb(Bitboard pawns, Bitboard empty) {
+  return pawn_pushes_bb<C>(pawn_pushes_bb<C>(pawns & (C == WHITE ? Rank2BB : Rank15BB), empty), empty);
+}
+
 /// adjacent_files_bb() returns a bitboard representing all the squares on the
 /// adjacent files of a given square.
 
@@ -194,7 +296,9 @@ constexpr Bitboard adjacent_files_bb(Square s) {
 
 inline Bitboard line_bb(Square s1, Square s2) {
   assert(is_ok(s1) && is_ok(s2));
-  return LineBB[s1][s2];
+  INSTRUMENT_COUNT(LINE_LOOKUPS);
+  int m = fold_mask(s1);
+  return unfold(tables().LineBB[fold_index(Square(s1 ^ m))][s2 ^ m], m);
 }
 
 /// between_bb(s1, s2) returns a bitboard representing the squares in the semi-open
@@ -207,7 +311,9 @@ inline Bitboard line_bb(Square s1, Square s2) {
 
 inline Bitboard between_bb(Square s1, Square s2) {
   assert(is_ok(s1) && is_ok(s2));
-  return BetweenBB[s1][s2];
+  INSTRUMENT_COUNT(BETWEEN_LOOKUPS);
+  int m = fold_mask(s1);
+  return unfold(tables().BetweenBB[fold_index(Square(s1 ^ m))][s2 ^ m], m);
 }
 
 /// forward_ranks_bb() returns a bitboard representing the squares on the ranks in
@@ -246,8 +352,7 @@ constexpr Bitboard passed_pawn_span(Color c, Square s) {
 /// straight or on a diagonal line.
 
 inline bool aligned(Square s1, Square s2, Square s3) {
-    Bitboard t = line_bb(s1, s2) & s3;
-    return (t.b[0] | t.b[1] | t.b[2] | t.b[3]);
+    return nonemptyBB(line_bb(s1, s2) & s3);
 }
 
 /// distance() functions return the distance between x and y, defined as the
@@ -256,7 +361,19 @@ inline bool aligned(Square s1, Square s2, Square s3) {
 template<typename T1 = Square> inline int distance(Square x, Square y);
 template<> inline int distance<File>(Square x, Square y) { return std::abs(file_of(x) - file_of(y)); }
 template<> inline int distance<Rank>(Square x, Square y) { return std::abs(rank_of(x) - rank_of(y)); }
-template<> inline int distance<Square>(Square x, Square y) { return SquareDistance[x][y]; }
+#if FOLDED_TABLES
+template<> inline int distance<Square>(Square x, Square y) { return std::max(distance<File>(x, y), distance<Rank>(x, y)); }
+#else
+template<> inline int distance<Square>(Square x, Square y) { return tables().SquareDistance[x][y]; }
+#endif
+
+/// pseudo_attacks() looks up the attacks of a piece type on an empty board
+/// in the possibly folded PseudoAttacks table.
+
+inline Bitboard pseudo_attacks(PieceType pt, Square s) {
+  int m = fold_mask(s);
+  return unfold(tables().PseudoAttacks[pt][fold_index(Square(s ^ m))], m);
+}
 
 inline int edge_distance(File f) { return std::min(f, File(FILE_P - f)); }
 inline int edge_distance(Rank r) { return std::min(r, Rank(RANK_16 - r)); }
@@ -267,7 +384,7 @@ inline int edge_distance(Rank r) { return std::min(r, Rank(RANK_16 - r)); }
 template<PieceType Pt>
 inline Bitboard attacks_bb(Square s) {
   assert((Pt != PAWN) && (is_ok(s)));
-  return PseudoAttacks[Pt][s];
+  return pseudo_attacks(Pt, s);
 }
 
 
@@ -276,8 +393,8 @@ inline Bitboard attacks_bb(Square s) {
 /// Sliding piece attacks do not continue past an occupied square.
 
 namespace Bitboards {
-  inline Bitboard RookAttacks(Square s, Bitboard occupied);
-  inline Bitboard BishopAttacks(Square s, Bitboard occupied);
+  Bitboard RookAttacks(Square s, Bitboard occupied);
+  Bitboard BishopAttacks(Square s, Bitboard occupied);
 }
 
 template<PieceType Pt>
@@ -288,7 +405,7 @@ inline Bitboard attacks_bb(Square s, Bitboard occupied) {
   case BISHOP: return Bitboards::BishopAttacks(s, occupied);
   case ROOK  : return Bitboards::RookAttacks(s, occupied);
   case QUEEN : return attacks_bb<BISHOP>(s, occupied) | attacks_bb<ROOK>(s, occupied);
-  default    : return PseudoAttacks[Pt][s];
+  default    : return pseudo_attacks(Pt, s);
   }
 }
 
@@ -299,52 +416,165 @@ inline Bitboard attacks_bb(PieceType pt, Square s, Bitboard occupied) {
   case BISHOP: return attacks_bb<BISHOP>(s, occupied);
   case ROOK  : return attacks_bb<  ROOK>(s, occupied);
   case QUEEN : return attacks_bb<BISHOP>(s, occupied) | attacks_bb<ROOK>(s, occupied);
-  default    : return PseudoAttacks[pt][s];
+  default    : return pseudo_attacks(pt, s);
   }
 }
 
+/// setwise_attacks() returns the union of the attacks of all the sliders in
+/// the given bitboard, using Kogge-Stone occluded fills: every direction takes
+/// four shift steps (1, 2, 4 and 8 squares, enough for 15 squares) whatever
+/// the number of pieces. The propagator masks off the file a fill would wrap
+/// into, and the last step is a plain shift<D>, which masks it as well.
+
+template<int N>
+constexpr Bitboard shift_raw(Bitboard b) {
+  if constexpr (N > 0)
+      return Words::shl<N>(b);
+  else
+      return Words::shr<-N>(b);
+}
+
+template<Direction D>
+constexpr Bitboard fill_mask() {
+  return D == EAST || D == NORTH_EAST || D == SOUTH_EAST ? ~FileABB
+       : D == WEST || D == NORTH_WEST || D == SOUTH_WEST ? ~FilePBB
+                                                         : AllSquares;
+}
+
+#if defined(USE_AVX2)
+
+/// With AVX2 the four 64-bit words are shifted at once: whole words move with
+/// a lane permute and the bits crossing a word boundary are merged back in
+/// from the neighbouring lane.
+
+namespace Avx2 {
+
+static_assert(SQUARE_NB == 256, "The AVX2 path holds a bitboard in one 256-bit register");
+
+inline __m256i load(Bitboard b) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b.b));
+}
+
+inline Bitboard store(__m256i v) {
+  Bitboard b;
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(b.b), v);
+  return b;
+}
+
+template<int L>
+inline __m256i shift_lanes(__m256i v) {
+  static_assert(L >= -3 && L <= 3, "Shift out of range in shift_lanes()");
+  const __m256i zero = _mm256_setzero_si256();
+  if constexpr (L == 0)       return v;
+  else if constexpr (L ==  1) return _mm256_blend_epi32(_mm256_permute4x64_epi64(v, 0x90), zero, 0x03);
+  else if constexpr (L ==  2) return _mm256_blend_epi32(_mm256_permute4x64_epi64(v, 0x40), zero, 0x0F);
+  else if constexpr (L ==  3) return _mm256_blend_epi32(_mm256_permute4x64_epi64(v, 0x00), zero, 0x3F);
+  else if constexpr (L == -1) return _mm256_blend_epi32(_mm256_permute4x64_epi64(v, 0xF9), zero, 0xC0);
+  else if constexpr (L == -2) return _mm256_blend_epi32(_mm256_permute4x64_epi64(v, 0xFE), zero, 0xF0);
+  else                        return _mm256_blend_epi32(_mm256_permute4x64_epi64(v, 0xFF), zero, 0xFC);
+}
+
+template<int N>
+inline __m256i shift_raw(__m256i v) {
+  constexpr int B = N % 64;
+  v = shift_lanes<N / 64>(v);
+  if constexpr (B > 0)
+      return _mm256_or_si256(_mm256_slli_epi64(v, B), _mm256_srli_epi64(shift_lanes<1>(v), 64 - B));
+  else if constexpr (B < 0)
+      return _mm256_or_si256(_mm256_srli_epi64(v, -B), _mm256_slli_epi64(shift_lanes<-1>(v), 64 + B));
+  else
+      return v;
+}
+
+template<Direction D>
+inline __m256i sliding_attacks(__m256i gen, __m256i empty) {
+  const __m256i mask = load(fill_mask<D>());
+  empty = _mm256_and_si256(empty, mask);
+  gen   = _mm256_or_si256(gen, _mm256_and_si256(empty, shift_raw<    D>(gen)));
+  empty = _mm256_and_si256(empty, shift_raw<    D>(empty));
+  gen   = _mm256_or_si256(gen, _mm256_and_si256(empty, shift_raw<2 * D>(gen)));
+  empty = _mm256_and_si256(empty, shift_raw<2 * D>(empty));
+  gen   = _mm256_or_si256(gen, _mm256_and_si256(empty, shift_raw<4 * D>(gen)));
+  empty = _mm256_and_si256(empty, shift_raw<4 * D>(empty));
+  gen   = _mm256_or_si256(gen, _mm256_and_si256(empty, shift_raw<8 * D>(gen)));
+  return _mm256_and_si256(shift_raw<D>(gen), mask);
+}
+
+} // namespace Avx2
+
+#endif
+
+template<Direction D>
+constexpr Bitboard occluded_fill(Bitboard gen, Bitboard empty) {
+  empty &= fill_mask<D>();
+  gen   |= empty & shift_raw<    D>(gen);
+  empty &=         shift_raw<    D>(empty);
+  gen   |= empty & shift_raw<2 * D>(gen);
+  empty &=         shift_raw<2 * D>(empty);
+  gen   |= empty & shift_raw<4 * D>(gen);
+  empty &=         shift_raw<4 * D>(empty);
+  gen   |= empty & shift_raw<8 * D>(gen);
+  return gen;
+}
+
+template<Direction D>
+constexpr Bitboard sliding_attacks(Bitboard sliders, Bitboard empty) {
+  return shift<D>(occluded_fill<D>(sliders, empty));
+}
+
+template<PieceType Pt>
+inline Bitboard setwise_attacks(Bitboard sliders, Bitboard occupied) {
+
+  static_assert(Pt == BISHOP || Pt == ROOK || Pt == QUEEN, "Unsupported piece type in setwise_attacks()");
+
+#if defined(USE_AVX2)
+  const __m256i gen = Avx2::load(sliders), empty = Avx2::load(~occupied);
+  __m256i attacks = _mm256_setzero_si256();
+
+  if constexpr (Pt != BISHOP)
+      attacks = _mm256_or_si256(
+                _mm256_or_si256(Avx2::sliding_attacks<NORTH>(gen, empty), Avx2::sliding_attacks<SOUTH>(gen, empty)),
+                _mm256_or_si256(Avx2::sliding_attacks<EAST >(gen, empty), Avx2::sliding_attacks<WEST >(gen, empty)));
+
+  if constexpr (Pt != ROOK)
+      attacks = _mm256_or_si256(attacks,
+                _mm256_or_si256(
+                _mm256_or_si256(Avx2::sliding_attacks<NORTH_EAST>(gen, empty), Avx2::sliding_attacks<SOUTH_EAST>(gen, empty)),
+                _mm256_or_si256(Avx2::sliding_attacks<NORTH_WEST>(gen, empty), Avx2::sliding_attacks<SOUTH_WEST>(gen, empty))));
+
+  return Avx2::store(attacks);
+#else
+  const Bitboard empty = ~occupied;
+  Bitboard attacks = NoSquares;
+
+  if constexpr (Pt != BISHOP)
+      attacks |=  sliding_attacks<NORTH>(sliders, empty) | sliding_attacks<SOUTH>(sliders, empty)
+                | sliding_attacks<EAST >(sliders, empty) | sliding_attacks<WEST >(sliders, empty);
+
+  if constexpr (Pt != ROOK)
+      attacks |=  sliding_attacks<NORTH_EAST>(sliders, empty) | sliding_attacks<SOUTH_EAST>(sliders, empty)
+                | sliding_attacks<NORTH_WEST>(sliders, empty) | sliding_attacks<SOUTH_WEST>(sliders, empty);
+
+  return attacks;
+#endif
+}
+
 /// popcount() counts the number of non-zero bits in a bitboard
-// Assumed gcc or compatible compiler
 inline int popcount(Bitboard b) {
-  return __builtin_popcountll(b.b[0]) + __builtin_popcountll(b.b[1]) + __builtin_popcountll(b.b[2]) + __builtin_popcountll(b.b[3]);
+  return Words::popcount(b);
 }
 
 /// lsb() and msb() return the least/most significant bit in a non-zero bitboard
-// Assumed gcc or compatible compiler
+
 inline Square lsb(Bitboard b) {
   assert(nonemptyBB(b));
-  if (b.b[0]) {
-    unsigned t = __builtin_ctzll(b.b[0]);
-    return make_square((File)(t & 0xF), (Rank)(t >> 4));
-  }
-  if (b.b[1]) {
-    unsigned t = __builtin_ctzll(b.b[1]);
-    return make_square((File)(t & 0xF), (Rank)((t >> 4) + 4));
-  }
-  if (b.b[2]) {
-    unsigned t = __builtin_ctzll(b.b[2]);
-    return make_square((File)(t & 0xF), (Rank)((t >> 4) + 8));
-  }
-  unsigned t = __builtin_ctzll(b.b[3]);
-  return make_square((File)(t & 0xF), (Rank)((t >> 4) + 12));
+  INSTRUMENT_COUNT(LSB);
+  return Square(Words::lsb(b));
 }
 
 inline Square msb(Bitboard b) {
   assert(nonemptyBB(b));
-  if (b.b[3]) {
-    unsigned t = 63 ^ __builtin_clzll(b.b[3]);
-    return make_square((File)(t & 0xF), (Rank)((t >> 4) + 12));
-  }
-  if (b.b[2]) {
-    unsigned t = 63 ^ __builtin_clzll(b.b[2]);
-    return make_square((File)(t & 0xF), (Rank)((t >> 4) + 8));
-  }
-  if (b.b[1]) {
-    unsigned t = 63 ^ __builtin_clzll(b.b[1]);
-    return make_square((File)(t & 0xF), (Rank)((t >> 4) + 4));
-  }
-  unsigned t = 63 ^ __builtin_clzll(b.b[0]);
-  return make_square((File)(t & 0xF), (Rank)(t >> 4));
+  return Square(Words::msb(b));
 }
 
 /// least_significant_square_bb() returns the bitboard of the least significant
@@ -359,6 +589,7 @@ inline Bitboard least_significant_square_bb(Bitboard b) {
 
 inline Square pop_lsb(Bitboard& b) {
   assert(nonemptyBB(b));
+  INSTRUMENT_COUNT(POP_LSB);
   const Square s = lsb(b);
   b &= ~square_bb(s);
   return s;
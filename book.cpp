@@ -0,0 +1,430 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2022 The Stockfish developers (see AUTHORS file)
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <algorithm>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <queue>
+#include <sstream>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "book.h"
+#include "movegen.h"
+#include "position.h"
+#include "uci.h"
+
+using std::string;
+
+namespace Stockfish {
+
+namespace {
+
+  // Record is a book entry under construction, with a weight that may still
+  // overflow 16 bits. Records of a run are sorted by key then move.
+  struct Record {
+    Key      key;
+    uint32_t move;
+    uint32_t weight;
+
+    bool operator<(const Record& r) const {
+      return key < r.key || (key == r.key && move < r.move);
+    }
+    bool same(const Record& r) const { return key == r.key && move == r.move; }
+  };
+
+  // sort_and_merge() sorts the records and adds up the weights of the
+  // duplicates, in place.
+  void sort_and_merge(std::vector<Record>& records) {
+
+    std::sort(records.begin(), records.end());
+
+    size_t n = 0;
+    for (size_t i = 0; i < records.size(); ++i)
+        if (n && records[n - 1].same(records[i]))
+            records[n - 1].weight += records[i].weight;
+        else
+            records[n++] = records[i];
+
+    records.resize(n);
+  }
+
+  // RunReader streams the records of a sorted run file
+  struct RunReader {
+    std::ifstream file;
+    Record current;
+
+    explicit RunReader(const string& path) : file(path, std::ios::binary) { next(); }
+    bool next() { return bool(file.read(reinterpret_cast<char*>(&current), sizeof(Record))); }
+  };
+
+  // BookWriter writes the final entries. The moves of a position are
+  // collected first so that, if the most played one overflows 16 bits, all
+  // of them can be scaled down together and keep their proportions.
+  class BookWriter {
+  public:
+    explicit BookWriter(const string& path) : file(path, std::ios::binary) {}
+
+    void add(const Record& r) {
+      if (!moves.empty() && moves.back().key != r.key)
+          flush();
+
+      if (!moves.empty() && moves.back().same(r))
+          moves.back().weight += r.weight;
+      else
+          moves.push_back(r);
+    }
+
+    void flush() {
+      uint32_t maxWeight = 0;
+      for (const Record& r : moves)
+          maxWeight = std::max(maxWeight, r.weight);
+
+      for (const Record& r : moves)
+      {
+          uint64_t w = maxWeight > 0xFFFF ? uint64_t(r.weight) * 0xFFFF / maxWeight : r.weight;
+          if (!w)
+              continue; // Never played by a side that did not lose
+
+          BookEntry e = { r.key, r.move, uint16_t(w), 0 };
+          file.write(reinterpret_cast<const char*>(&e), sizeof(e));
+          ++written;
+      }
+      moves.clear();
+    }
+
+    bool good() const { return bool(file); }
+    size_t written = 0;
+
+  private:
+    std::ofstream file;
+    std::vector<Record> moves;
+  };
+
+  // parse_game() replays one game record and appends a record per book ply.
+  // The format is a line "[startpos | fen <fen>] [moves] <move>... [result]"
+  // with moves in coordinate notation and a result of 1-0, 0-1 or 1/2-1/2.
+  // A win gives the moves of the winner 2 points, a draw gives 1 point to
+  // both sides and a loss 0, an unknown result counts as a draw. A game with
+  // an illegal move is skipped as a whole, out is then left unchanged.
+  bool parse_game(const string& line, int maxPly, std::vector<Record>& out) {
+
+    std::istringstream is(line);
+    string token, fen = StartFEN;
+    std::vector<string> moves;
+    int points[COLOR_NB] = { 1, 1 };
+
+    while (is >> token)
+        if (token == "fen")
+        {
+            // A FEN has five fields, the moves may follow without the keyword
+            fen.clear();
+            for (int field = 0; field < 5 && is >> token && token != "moves"; ++field)
+                fen += token + " ";
+        }
+        else if (token == "1-0")
+            points[WHITE] = 2, points[BLACK] = 0;
+        else if (token == "0-1")
+            points[WHITE] = 0, points[BLACK] = 2;
+        else if (token != "startpos" && token != "moves" && token != "1/2-1/2" && token != "*")
+            moves.push_back(token);
+
+    if (!Position::valid_fen(fen))
+        return false;
+
+    std::deque<StateInfo> states(1);
+    const size_t first = out.size();
+    Position pos;
+    pos.set(fen, &states.back());
+
+    for (size_t ply = 0; ply < moves.size() && int(ply) < maxPly; ++ply)
+    {
+        Move m = UCI::to_move(pos, moves[ply]);
+        if (m == MOVE_NONE)
+        {
+            out.resize(first);
+            return false;
+        }
+
+        out.push_back({ pos.key(), uint32_t(m), uint32_t(points[pos.side_to_move()]) });
+
+        states.emplace_back();
+        pos.do_move(m, states.back());
+    }
+    return true;
+  }
+
+} // namespace
+
+
+/// Book::open() maps the given book file. Returns false, leaving the book
+/// empty, if the file cannot be read or is not a whole number of entries.
+
+bool Book::open(const string& path) {
+
+  close();
+
+#ifdef __linux__
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+      return false;
+
+  struct stat st;
+  if (fstat(fd, &st) < 0 || st.st_size % sizeof(BookEntry))
+  {
+      ::close(fd);
+      return false;
+  }
+
+  if (st.st_size)
+  {
+      void* mem = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+      if (mem == MAP_FAILED)
+      {
+          ::close(fd);
+          return false;
+      }
+
+      madvise(mem, st.st_size, MADV_RANDOM); // Probes jump around, do not read ahead
+      entries = static_cast<const BookEntry*>(mem);
+      mappedSize = st.st_size;
+      count = st.st_size / sizeof(BookEntry);
+  }
+
+  ::close(fd); // The mapping keeps the file open
+  return true;
+#else
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file || file.tellg() % sizeof(BookEntry))
+      return false;
+
+  copy.resize(size_t(file.tellg()) / sizeof(BookEntry));
+  file.seekg(0);
+  file.read(reinterpret_cast<char*>(copy.data()), copy.size() * sizeof(BookEntry));
+  entries = copy.data();
+  count = copy.size();
+  return bool(file);
+#endif
+}
+
+
+void Book::close() {
+
+#ifdef __linux__
+  if (mappedSize)
+      munmap(const_cast<BookEntry*>(entries), mappedSize);
+#endif
+
+  copy.clear();
+  entries = nullptr;
+  count = mappedSize = 0;
+}
+
+
+/// Book::lower_bound() returns the first entry with a key not less than the
+/// given one. Zobrist keys are uniformly distributed, so the position of the
+/// key interpolated between the first and last keys is off by about the
+/// square root of the book size. From there the search gallops outwards,
+/// doubling the step until the key is bracketed, then bisects: most probes
+/// land on pages and cache lines already touched by the first one, while a
+/// plain binary search takes a cold miss on nearly every step.
+
+const BookEntry* Book::lower_bound(Key key) const {
+
+  if (!count || key <= entries[0].key)
+      return entries;
+
+  if (key > entries[count - 1].key)
+      return entries + count;
+
+  const Key kl = entries[0].key, kh = entries[count - 1].key;
+  size_t mid = size_t(double(key - kl) / double(kh - kl) * double(count - 1));
+  size_t first, last; // The answer is in [first, last]
+  size_t p = mid = std::min(mid, count - 1), step = 1;
+
+  if (entries[mid].key < key)
+  {
+      while (p + step < count && entries[p + step].key < key)
+          p += step, step *= 2;
+
+      first = p + 1, last = std::min(p + step, count);
+  }
+  else
+  {
+      while (p >= step && entries[p - step].key >= key)
+          p -= step, step *= 2;
+
+      first = p >= step ? p - step + 1 : 0, last = p;
+  }
+
+  return std::lower_bound(entries + first, entries + last, key,
+                          [](const BookEntry& e, Key k) { return e.key < k; });
+}
+
+
+/// Book::probe() returns the range of the entries of the given key
+
+std::pair<const BookEntry*, const BookEntry*> Book::probe(Key key) const {
+
+  const BookEntry* first = lower_bound(key);
+  const BookEntry* last = first;
+
+  while (last != entries + count && last->key == key)
+      ++last;
+
+  return { first, last };
+}
+
+
+/// Book::probe() returns a book move for the given position, either the one
+/// with the highest weight or one picked at random in proportion to the
+/// weights, or MOVE_NONE. Moves are checked to be legal, to guard against
+/// key collisions.
+
+Move Book::probe(const Position& pos, bool pickBest) const {
+
+  static thread_local PRNG rng(uint64_t(now()) | 1);
+
+  auto [first, last] = probe(pos.key());
+  MoveList<LEGAL> legal(pos);
+  Move best = MOVE_NONE;
+  uint64_t total = 0, bestWeight = 0;
+
+  for (const BookEntry* e = first; e != last; ++e)
+  {
+      if (!legal.contains(Move(e->move)) || !e->weight)
+          continue;
+
+      total += e->weight;
+
+      // Choose the move with the highest weight, or choose a move with a
+      // probability that is proportional to its weight (reservoir sampling).
+      if (pickBest ? e->weight > bestWeight : rng.rand<uint64_t>() % total < e->weight)
+          best = Move(e->move), bestWeight = e->weight;
+  }
+
+  return best;
+}
+
+
+/// Book::build() makes a book of the first maxPly plies of the games in the
+/// given file, one game per line (see parse_game()). Records are gathered
+/// in memory up to memoryMb, then sorted and written to a temporary run
+/// file; the runs are finally merged into the book. Inputs of any size are
+/// thus handled with bounded memory.
+
+bool Book::build(const string& gamesPath, const string& bookPath,
+                 int maxPly, size_t memoryMb, std::ostream& log) {
+
+  std::ifstream games(gamesPath);
+  if (!games)
+  {
+      log << "Cannot open " << gamesPath << std::endl;
+      return false;
+  }
+
+  const size_t maxRecords = std::max(size_t(1024), memoryMb * 1024 * 1024 / sizeof(Record));
+  std::vector<Record> records;
+  std::vector<string> runs;
+  size_t gameCount = 0, skipped = 0;
+  string line;
+
+  records.reserve(maxRecords);
+
+  auto write_run = [&]() {
+      sort_and_merge(records);
+      runs.push_back(bookPath + ".run" + std::to_string(runs.size()));
+      std::ofstream run(runs.back(), std::ios::binary);
+      run.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(Record));
+      records.clear();
+      return bool(run);
+  };
+
+  while (std::getline(games, line))
+  {
+      if (line.find_first_not_of(" \t\r") == string::npos)
+          continue;
+
+      if (parse_game(line, maxPly, records))
+          ++gameCount;
+      else
+          ++skipped;
+
+      if (records.size() >= maxRecords && !write_run())
+      {
+          log << "Cannot write run file " << runs.back() << std::endl;
+          return false;
+      }
+  }
+
+  BookWriter writer(bookPath);
+
+  if (runs.empty()) // Everything fit in memory
+  {
+      sort_and_merge(records);
+      for (const Record& r : records)
+          writer.add(r);
+  }
+  else
+  {
+      if (!records.empty() && !write_run())
+      {
+          log << "Cannot write run file " << runs.back() << std::endl;
+          return false;
+      }
+
+      // K-way merge of the runs, smallest record first
+      std::vector<std::unique_ptr<RunReader>> readers;
+      auto cmp = [&](size_t a, size_t b) { return readers[b]->current < readers[a]->current; };
+      std::priority_queue<size_t, std::vector<size_t>, decltype(cmp)> heap(cmp);
+
+      for (const string& run : runs)
+      {
+          readers.push_back(std::make_unique<RunReader>(run));
+          if (readers.back()->file)
+              heap.push(readers.size() - 1);
+      }
+
+      while (!heap.empty())
+      {
+          size_t idx = heap.top();
+          heap.pop();
+          writer.add(readers[idx]->current);
+          if (readers[idx]->next())
+              heap.push(idx);
+      }
+
+      readers.clear();
+      for (const string& run : runs)
+          std::remove(run.c_str());
+  }
+
+  writer.flush();
+
+  log << "Games: " << gameCount << ", skipped: " << skipped
+      << ", runs: " << runs.size() << ", entries: " << writer.written << std::endl;
+
+  return writer.good();
+}
+
+} // namespace Stockfish
@@ -0,0 +1,81 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2022 The Stockfish developers (see AUTHORS file)
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef BOOK_H_INCLUDED
+#define BOOK_H_INCLUDED
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "types.h"
+
+namespace Stockfish {
+
+class Position;
+
+/// BookEntry is the 16 bytes record of the opening book file. A book is an
+/// array of entries sorted by key then move, with no header, stored in the
+/// byte order of the host (little-endian on all supported targets). The key
+/// is Position::key(), the move the 20 bits Move of the position, the weight
+/// its relative frequency and learn is reserved for book learning.
+
+struct BookEntry {
+  Key      key;
+  uint32_t move;
+  uint16_t weight;
+  uint16_t learn;
+};
+
+static_assert(sizeof(BookEntry) == 16, "Unexpected BookEntry size");
+
+
+/// Book gives read-only access to a book file. The file is memory-mapped and
+/// shared, so opening is immediate whatever the size of the book, pages are
+/// loaded as probes touch them, and all the processes using the same book
+/// share one copy in the page cache.
+
+class Book {
+public:
+  Book() = default;
+  Book(const Book&) = delete;
+  Book& operator=(const Book&) = delete;
+ ~Book() { close(); }
+
+  bool open(const std::string& path);
+  void close();
+  size_t size() const { return count; }
+
+  std::pair<const BookEntry*, const BookEntry*> probe(Key key) const;
+  Move probe(const Position& pos, bool pickBest) const;
+
+  static bool build(const std::string& gamesPath, const std::string& bookPath,
+                    int maxPly, size_t memoryMb, std::ostream& log);
+
+private:
+  const BookEntry* lower_bound(Key key) const;
+
+  const BookEntry* entries = nullptr;
+  size_t count = 0;
+  size_t mappedSize = 0;
+  std::vector<BookEntry> copy; // Without mmap()
+};
+
+} // namespace Stockfish
+
+#endif // #ifndef BOOK_H_INCLUDED
@@ -0,0 +1,249 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2022 The Stockfish developers (see AUTHORS file)
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+#include "bitboard.h"
+#include "evaluate.h"
+#include "position.h"
+
+namespace Stockfish {
+
+namespace {
+
+  // The start position holds about 2.5 times the non-pawn material of the
+  // 8x8 one, so the game phase limits are scaled accordingly.
+  constexpr int MidgameLimit16 = MidgameLimit * 5 / 2;
+  constexpr int EndgameLimit16 = EndgameLimit * 5 / 2;
+
+  // Bonus for every square attacked, and for every rank a pawn has advanced
+  constexpr Score Space       = make_score(4, 2);
+  constexpr Score PawnAdvance = make_score(2, 12);
+
+  constexpr Value Tempo = Value(28);
+
+  // The evaluation terms are weights over a few inputs of the position.
+  // Material and space only depend on counts, so they are a dense layer over
+  // a few counts per position. The pawn term depends on squares: it is the
+  // sum of a pawn-square table over the list of the pawns, a sparse input.
+  enum Feature { PIECE_COUNTS = 0, ATTACKED_COUNTS = 2 * QUEEN, FEATURE_NB = ATTACKED_COUNTS + COLOR_NB };
+
+  constexpr int feature(Color c, PieceType pt) { return PIECE_COUNTS + c * QUEEN + pt - PAWN; }
+
+  struct Weights {
+    int mg[FEATURE_NB], eg[FEATURE_NB], npm[FEATURE_NB];
+    int pawnMg[COLOR_NB * SQUARE_NB], pawnEg[COLOR_NB * SQUARE_NB];
+  };
+
+  // Weights of the terms, signed by color as they are summed from white's
+  // point of view. terms() and the batched evaluation both read this table,
+  // the sums wrap as the packed Scores do, so that both return the same values.
+  const Weights TermWeights = [] {
+
+    Weights w = {};
+
+    for (Color c : { WHITE, BLACK })
+    {
+        const int sign = c == WHITE ? 1 : -1;
+
+        for (PieceType pt = PAWN; pt <= QUEEN; ++pt)
+        {
+            w.mg[feature(c, pt)] = sign * PieceValue[MG][pt];
+            w.eg[feature(c, pt)] = sign * PieceValue[EG][pt];
+            w.npm[feature(c, pt)] = pt != PAWN ? PieceValue[MG][pt] : 0;
+        }
+
+        w.mg[ATTACKED_COUNTS + c] = sign * mg_value(Space);
+        w.eg[ATTACKED_COUNTS + c] = sign * eg_value(Space);
+
+        for (Square s = SQ_A1; s <= SQ_P16; ++s)
+        {
+            w.pawnMg[c * SQUARE_NB + s] = sign * mg_value(PawnAdvance) * (relative_rank(c, s) - RANK_2);
+            w.pawnEg[c * SQUARE_NB + s] = sign * eg_value(PawnAdvance) * (relative_rank(c, s) - RANK_2);
+        }
+    }
+    return w;
+  }();
+
+  // Terms of the evaluation, from white's point of view
+  struct Terms {
+    Score material, space, pawns;
+    int npm;
+  };
+
+  Terms terms(const Position& pos) {
+
+    const Weights& w = TermWeights;
+    Terms t = { SCORE_ZERO, SCORE_ZERO, SCORE_ZERO, 0 };
+
+    for (Color c : { WHITE, BLACK })
+    {
+        for (PieceType pt = PAWN; pt <= QUEEN; ++pt)
+        {
+            const int f = feature(c, pt), n = popcount(pos.pieces(c, pt));
+            t.material += make_score(w.mg[f], w.eg[f]) * n;
+            t.npm += w.npm[f] * n;
+        }
+
+        const int f = ATTACKED_COUNTS + c;
+        t.space += make_score(w.mg[f], w.eg[f]) * popcount(pos.attack_map().attacked_by(c));
+
+        Bitboard b = pos.pieces(c, PAWN);
+        while (nonemptyBB(b))
+        {
+            const int k = c * SQUARE_NB + pop_lsb(b);
+            t.pawns += make_score(w.pawnMg[k], w.pawnEg[k]);
+        }
+    }
+    return t;
+  }
+
+  // phase() returns the game phase, from PHASE_ENDGAME to PHASE_MIDGAME
+  int phase(int npm) {
+
+    npm = std::clamp(npm, EndgameLimit16, MidgameLimit16);
+    return (npm - EndgameLimit16) * PHASE_MIDGAME / (MidgameLimit16 - EndgameLimit16);
+  }
+
+  double to_cp(Value v) { return double(v) / 100; }
+
+  Value taper(Score s, int ph) {
+    return Value((mg_value(s) * ph + eg_value(s) * (PHASE_MIDGAME - ph)) / PHASE_MIDGAME);
+  }
+
+  // Positions of a block of the batched evaluation
+  constexpr size_t BatchSize = 64;
+
+  // evaluate_block() evaluates up to BatchSize positions in three passes:
+  // extraction of the counts and of the pawn lists, then the dense layer
+  // and the gather over the pawn lists, each one over the whole block.
+  void evaluate_block(const Position* const positions[], size_t count, Value values[],
+                      std::vector<uint16_t>& pawns) {
+
+    int16_t x[FEATURE_NB][BatchSize];
+    size_t offsets[BatchSize + 1] = { 0 };
+    int mg[BatchSize] = {}, eg[BatchSize] = {}, npm[BatchSize] = {};
+
+    pawns.clear();
+
+    for (size_t n = 0; n < count; ++n)
+    {
+        const Position& pos = *positions[n];
+
+        for (Color c : { WHITE, BLACK })
+        {
+            for (PieceType pt = KNIGHT; pt <= QUEEN; ++pt)
+                x[feature(c, pt)][n] = int16_t(popcount(pos.pieces(c, pt)));
+
+            x[ATTACKED_COUNTS + c][n] = int16_t(popcount(pos.attack_map().attacked_by(c)));
+
+            Bitboard b = pos.pieces(c, PAWN);
+            const size_t first = pawns.size();
+            while (nonemptyBB(b))
+                pawns.push_back(uint16_t(c * SQUARE_NB + pop_lsb(b)));
+
+            x[feature(c, PAWN)][n] = int16_t(pawns.size() - first);
+        }
+        offsets[n + 1] = pawns.size();
+    }
+
+    // Each weight is loaded once for the block, the inner loops vectorize
+    for (int f = 0; f < FEATURE_NB; ++f)
+    {
+        const int wm = TermWeights.mg[f], we = TermWeights.eg[f], wn = TermWeights.npm[f];
+
+        for (size_t n = 0; n < count; ++n)
+        {
+            mg[n]  += wm * x[f][n];
+            eg[n]  += we * x[f][n];
+            npm[n] += wn * x[f][n];
+        }
+    }
+
+    for (size_t n = 0; n < count; ++n)
+        for (size_t k = offsets[n]; k < offsets[n + 1]; ++k)
+        {
+            mg[n] += TermWeights.pawnMg[pawns[k]];
+            eg[n] += TermWeights.pawnEg[pawns[k]];
+        }
+
+    for (size_t n = 0; n < count; ++n)
+    {
+        Value v = taper(make_score(mg[n], eg[n]), phase(npm[n]));
+        values[n] = (positions[n]->side_to_move() == WHITE ? v : -v) + Tempo;
+    }
+  }
+
+} // namespace
+
+
+/// evaluate() is the evaluator for the outer world. It returns a static
+/// evaluation of the position from the point of view of the side to move.
+
+Value Eval::evaluate(const Position& pos) {
+
+  Terms t = terms(pos);
+  Value v = taper(t.material + t.space + t.pawns, phase(t.npm));
+
+  return (pos.side_to_move() == WHITE ? v : -v) + Tempo;
+}
+
+
+/// evaluate() over a batch sets values[i] to evaluate(*positions[i]) for the
+/// count positions, working through them by blocks of BatchSize. It is the
+/// path for scoring many unrelated positions, e.g. the lines of a FEN file.
+
+void Eval::evaluate(const Position* const positions[], size_t count, Value values[]) {
+
+  std::vector<uint16_t> pawns;
+
+  for (size_t i = 0; i < count; i += BatchSize)
+      evaluate_block(positions + i, std::min(BatchSize, count - i), values + i, pawns);
+}
+
+
+/// trace() is like evaluate(), but instead of returning a value, it returns
+/// a string (suitable for outputting to stdout) that contains the detailed
+/// descriptions and values of each evaluation term. Useful for debugging.
+
+std::string Eval::trace(const Position& pos) {
+
+  Terms t = terms(pos);
+  int ph = phase(t.npm);
+  std::stringstream ss;
+
+  ss << std::showpos << std::noshowpoint << std::fixed << std::setprecision(2)
+     << "     Term |    MG    EG | Total\n"
+     << " ---------+-------------+------\n";
+
+  for (auto [name, s] : { std::pair<const char*, Score>{ " Material", t.material },
+                          { "    Space", t.space },
+                          { "    Pawns", t.pawns } })
+      ss << name << " | " << std::setw(5) << to_cp(mg_value(s))
+         << " " << std::setw(5) << to_cp(eg_value(s))
+         << " | " << std::setw(5) << to_cp(taper(s, ph)) << "\n";
+
+  ss << "\nPhase: " << std::noshowpos << ph << "/" << int(PHASE_MIDGAME)
+     << "\nFinal evaluation: " << std::showpos << to_cp(evaluate(pos))
+     << " (side to move)\n";
+
+  return ss.str();
+}
+
+} // namespace Stockfish
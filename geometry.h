@@ -0,0 +1,390 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2022 The Stockfish developers (see AUTHORS file)
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef GEOMETRY_H_INCLUDED
+#define GEOMETRY_H_INCLUDED
+
+#include <type_traits>
+#include <utility>
+
+#include "types.h"
+
+namespace Stockfish {
+
+/// Words gathers the few primitives the generic geometry needs on the three
+/// kinds of bitboard words: uint64_t, unsigned __int128 and WideBitboard.
+
+namespace Words {
+
+template<typename W> struct IsWide : std::false_type {};
+template<int N> struct IsWide<WideBitboard<N>> : std::true_type {};
+
+constexpr bool any(uint64_t w) { return w; }
+constexpr bool any(unsigned __int128 w) { return w != 0; }
+
+// The wide versions are unrolled over the words at compile time, as pack
+// expansions or as a chain of tests from one end of the bitboard.
+
+template<int N, size_t... I>
+__attribute__((always_inline)) constexpr bool any(const WideBitboard<N>& w, std::index_sequence<I...>) {
+  return (w.b[I] | ...);
+}
+
+template<int N>
+__attribute__((always_inline)) constexpr bool any(const WideBitboard<N>& w) {
+  return any(w, std::make_index_sequence<N>());
+}
+
+inline int popcount(uint64_t w) { return __builtin_popcountll(w); }
+inline int popcount(unsigned __int128 w) { return popcount(uint64_t(w)) + popcount(uint64_t(w >> 64)); }
+
+template<int N, size_t... I>
+__attribute__((always_inline)) inline int popcount(const WideBitboard<N>& w, std::index_sequence<I...>) {
+  return (__builtin_popcountll(w.b[I]) + ...);
+}
+
+template<int N>
+__attribute__((always_inline)) inline int popcount(const WideBitboard<N>& w) {
+  return popcount(w, std::make_index_sequence<N>());
+}
+
+inline int lsb(uint64_t w) { return __builtin_ctzll(w); }
+inline int lsb(unsigned __int128 w) { return uint64_t(w) ? lsb(uint64_t(w)) : 64 + lsb(uint64_t(w >> 64)); }
+
+template<int I = 0, int N>
+__attribute__((always_inline)) inline int lsb(const WideBitboard<N>& w) {
+  if constexpr (I == N - 1)
+      return 64 * I + __builtin_ctzll(w.b[I]);
+  else
+      return w.b[I] ? 64 * I + __builtin_ctzll(w.b[I]) : lsb<I + 1>(w);
+}
+
+inline int msb(uint64_t w) { return 63 ^ __builtin_clzll(w); }
+inline int msb(unsigned __int128 w) { return uint64_t(w >> 64) ? 64 + msb(uint64_t(w >> 64)) : msb(uint64_t(w)); }
+
+template<int I = -1, int N>
+__attribute__((always_inline)) inline int msb(const WideBitboard<N>& w) {
+  constexpr int J = I < 0 ? N - 1 : I;
+  if constexpr (J == 0)
+      return 63 ^ __builtin_clzll(w.b[0]);
+  else
+      return w.b[J] ? 64 * J + (63 ^ __builtin_clzll(w.b[J])) : msb<J - 1>(w);
+}
+
+/// shl() and shr() shift a word by a constant number of bits, unrolled at
+/// compile time on the wide words.
+
+template<int Bits, typename W>
+__attribute__((always_inline)) constexpr W shl(W w) {
+  if constexpr (IsWide<W>::value)
+      return w.template shl<Bits>();
+  else
+      return w << Bits;
+}
+
+template<int Bits, typename W>
+__attribute__((always_inline)) constexpr W shr(W w) {
+  if constexpr (IsWide<W>::value)
+      return w.template shr<Bits>();
+  else
+      return w >> Bits;
+}
+
+constexpr bool more_than_one(uint64_t w) { return w & (w - 1); }
+constexpr bool more_than_one(unsigned __int128 w) { return (w & (w - 1)) != 0; }
+
+/// On wide words, more than one bit is either two bits in one word or bits
+/// in two words.
+template<int N>
+constexpr bool more_than_one(const WideBitboard<N>& w) {
+  int words = 0;
+  for (int i = 0; i < N; ++i)
+  {
+      if (w.b[i] & (w.b[i] - 1))
+          return true;
+      words += w.b[i] != 0;
+  }
+  return words > 1;
+}
+
+/// bit() returns the word with only bit n set, low() the word with the n
+/// least significant bits set.
+
+template<typename W>
+constexpr W bit(int n) {
+  if constexpr (IsWide<W>::value)
+      return W::generate([&](int i) { return i == n / 64 ? 1ULL << (n % 64) : 0; });
+  else
+      return W(1) << n;
+}
+
+template<typename W>
+constexpr W low(int n) {
+  if constexpr (IsWide<W>::value)
+      return W::generate([&](int i) { return  n >= 64 * (i + 1) ? ~0ULL
+                                            : n <= 64 * i       ? 0
+                                                                : (1ULL << (n % 64)) - 1; });
+  else
+      return n >= int(8 * sizeof(W)) ? ~W(0) : (W(1) << n) - 1;
+}
+
+} // namespace Words
+
+
+/// Geometry describes a board of the given dimensions: its square, file, rank
+/// and direction types, its bitboard word, which is the narrowest one that
+/// holds the board (see BitboardWord), its masks and shifts, and the builders
+/// of its attack tables. Squares are numbered rank by rank, a1 = 0, and
+/// square s is bit s of the bitboard, so a board of 64 squares or less takes
+/// a single register.
+///
+/// The engine plays on Geometry<BOARD_FILES, BOARD_RANKS>, aliased to Board:
+/// the named Square, File, Rank and Direction values of types.h are those of
+/// Board. The masks and the word helpers of bitboard.h (nonemptyBB, popcount,
+/// lsb, msb, more_than_one, ...) go through Board and Words, so they follow
+/// BOARD_FILES and BOARD_RANKS. A few parts still assume whole 64-bit words
+/// of 16-square ranks and check it with static_asserts: the AVX2 fills, the
+/// flips of the folded tables and SummaryBitboard. Other geometries (8x8,
+/// 10x10, 12x12, ...) share all of the code below.
+
+template<int Files, int Ranks>
+struct Geometry {
+
+  static_assert(Files >= 2 && Files <= 16 && Ranks >= 2 && Ranks <= 16,
+                "A square must fit in the 8 bits of a Move");
+
+  static constexpr int FILE_NB   = Files;
+  static constexpr int RANK_NB   = Ranks;
+  static constexpr int SQUARE_NB = Files * Ranks;
+
+  using Bitboard = BitboardWord<SQUARE_NB>;
+
+  enum Square : int { SQ_A1, SQ_NONE = SQUARE_NB };
+  enum File   : int { FILE_A, FILE_LAST = Files - 1 };
+  enum Rank   : int { RANK_1, RANK_LAST = Ranks - 1 };
+
+  enum Direction : int {
+    NORTH =  Files,
+    EAST  =  1,
+    SOUTH = -NORTH,
+    WEST  = -EAST,
+
+    NORTH_EAST = NORTH + EAST,
+    SOUTH_EAST = SOUTH + EAST,
+    SOUTH_WEST = SOUTH + WEST,
+    NORTH_WEST = NORTH + WEST
+  };
+
+  static constexpr bool is_ok(Square s) { return s >= SQ_A1 && s < SQ_NONE; }
+  static constexpr File file_of(Square s) { return File(s % Files); }
+  static constexpr Rank rank_of(Square s) { return Rank(s / Files); }
+  static constexpr Square make_square(File f, Rank r) { return Square(r * Files + f); }
+
+  static constexpr Square flip_rank(Square s) { return make_square(file_of(s), Rank(RANK_LAST - rank_of(s))); }
+  static constexpr Square flip_file(Square s) { return make_square(File(FILE_LAST - file_of(s)), rank_of(s)); }
+
+  static constexpr Bitboard NoSquares  = Words::low<Bitboard>(0);
+  static constexpr Bitboard AllSquares = Words::low<Bitboard>(SQUARE_NB);
+  static constexpr Bitboard Rank1BB    = Words::low<Bitboard>(Files);
+
+  static constexpr Bitboard file_a() {
+    Bitboard b = NoSquares;
+    for (int r = 0; r < Ranks; ++r)
+        b = b | Words::bit<Bitboard>(r * Files);
+    return b;
+  }
+
+  static constexpr Bitboard dark_squares() {
+    Bitboard b = NoSquares;
+    for (int s = 0; s < SQUARE_NB; ++s)
+        if ((s % Files + s / Files) % 2 == 0)
+            b = b | Words::bit<Bitboard>(s);
+    return b;
+  }
+
+  static constexpr Bitboard DarkSquares = dark_squares();
+  static constexpr Bitboard FileABB    = file_a();
+  static constexpr Bitboard FileLastBB = FileABB << (Files - 1);
+
+  static constexpr Bitboard square_bb(Square s) { return Words::bit<Bitboard>(s); }
+  static constexpr Bitboard rank_bb(Rank r) { return Rank1BB << (Files * r); }
+  static constexpr Bitboard file_bb(File f) { return FileABB << f; }
+
+  /// clip() drops the bits beyond the last square, which a shift towards the
+  /// north may set when the word is wider than the board.
+
+  static constexpr Bitboard clip(Bitboard b) {
+    if constexpr (SQUARE_NB % 64 != 0)
+        return b & AllSquares;
+    else
+        return b;
+  }
+
+  /// shift() moves a bitboard one or two steps as specified by the direction D
+
+  template<Direction D>
+  static constexpr Bitboard shift(Bitboard b) {
+    using Words::shl, Words::shr;
+
+    if constexpr (D == NORTH)            return clip(shl<Files>(b));
+    else if constexpr (D == SOUTH)       return shr<Files>(b);
+    else if constexpr (D == NORTH+NORTH) return clip(shl<2 * Files>(b));
+    else if constexpr (D == SOUTH+SOUTH) return shr<2 * Files>(b);
+    else if constexpr (D == EAST)        return clip(shl<1>(b & ~FileLastBB));
+    else if constexpr (D == WEST)        return shr<1>(b & ~FileABB);
+    else if constexpr (D == NORTH_EAST)  return clip(shl<Files + 1>(b & ~FileLastBB));
+    else if constexpr (D == NORTH_WEST)  return clip(shl<Files - 1>(b & ~FileABB));
+    else if constexpr (D == SOUTH_EAST)  return shr<Files - 1>(b & ~FileLastBB);
+    else if constexpr (D == SOUTH_WEST)  return shr<Files + 1>(b & ~FileABB);
+    else                                 return NoSquares;
+  }
+
+  /// step() returns the square at the given file and rank offsets from s, or
+  /// SQ_NONE when it is off the board.
+
+  static constexpr Square step(Square s, int df, int dr) {
+    const int f = file_of(s) + df, r = rank_of(s) + dr;
+    return f >= 0 && f < Files && r >= 0 && r < Ranks ? make_square(File(f), Rank(r)) : SQ_NONE;
+  }
+
+  /// sliding_attacks() returns the attacks of a bishop or a rook on s, rays
+  /// stopping on the first occupied square.
+
+  template<PieceType Pt>
+  static Bitboard sliding_attacks(Square s, Bitboard occupied) {
+
+    static_assert(Pt == BISHOP || Pt == ROOK, "Unsupported piece type in sliding_attacks()");
+
+    constexpr int Steps[2][4][2] = { { { 1, 1 }, { 1, -1 }, { -1, -1 }, { -1, 1 } },
+                                     { { 0, 1 }, { 0, -1 }, { 1, 0 }, { -1, 0 } } };
+    Bitboard attacks = NoSquares;
+
+    for (const auto& d : Steps[Pt == ROOK])
+        for (Square sq = step(s, d[0], d[1]); sq != SQ_NONE; sq = step(sq, d[0], d[1]))
+        {
+            attacks |= square_bb(sq);
+            if (Words::any(occupied & square_bb(sq)))
+                break;
+        }
+
+    return attacks;
+  }
+
+  /// Builders of the attack tables, square by square
+
+  static Bitboard leaper_attacks(Square s, const int (&steps)[8][2]) {
+    Bitboard b = NoSquares;
+    for (const auto& d : steps)
+        if (step(s, d[0], d[1]) != SQ_NONE)
+            b |= square_bb(step(s, d[0], d[1]));
+    return b;
+  }
+
+  static Bitboard pseudo_attacks(PieceType pt, Square s) {
+
+    constexpr int KingSteps[8][2]   = { { -1, -1 }, { 0, -1 }, { 1, -1 }, { -1, 0 }, { 1, 0 }, { -1, 1 }, { 0, 1 }, { 1, 1 } };
+    constexpr int KnightSteps[8][2] = { { -1, -2 }, { 1, -2 }, { -2, -1 }, { 2, -1 }, { -2, 1 }, { 2, 1 }, { -1, 2 }, { 1, 2 } };
+
+    switch (pt)
+    {
+    case KING  : return leaper_attacks(s, KingSteps);
+    case KNIGHT: return leaper_attacks(s, KnightSteps);
+    case BISHOP: return sliding_attacks<BISHOP>(s, NoSquares);
+    case ROOK  : return sliding_attacks<ROOK  >(s, NoSquares);
+    case QUEEN : return sliding_attacks<BISHOP>(s, NoSquares) | sliding_attacks<ROOK>(s, NoSquares);
+    default    : return NoSquares;
+    }
+  }
+
+  static Bitboard pawn_attacks(Color c, Square s) {
+    return c == WHITE ? shift<NORTH_WEST>(square_bb(s)) | shift<NORTH_EAST>(square_bb(s))
+                      : shift<SOUTH_WEST>(square_bb(s)) | shift<SOUTH_EAST>(square_bb(s));
+  }
+
+  static int distance(Square s1, Square s2) {
+    return std::max(std::abs(file_of(s1) - file_of(s2)), std::abs(rank_of(s1) - rank_of(s2)));
+  }
+
+  /// line() is the whole line through s1 and s2, empty when they are not
+  /// aligned. between() is the squares from s1 excluded to s2 included, just
+  /// s2 when they are not aligned (see line_bb() and between_bb()).
+
+  static Bitboard line(Square s1, Square s2) {
+    for (PieceType pt : { BISHOP, ROOK })
+        if (pt_aligned(pt, s1, s2))
+            return (pseudo_attacks(pt, s1) & pseudo_attacks(pt, s2)) | square_bb(s1) | square_bb(s2);
+    return NoSquares;
+  }
+
+  static Bitboard between(Square s1, Square s2) {
+
+    Bitboard b = square_bb(s2);
+
+    if (pt_aligned(BISHOP, s1, s2))
+        b |= sliding_attacks<BISHOP>(s1, square_bb(s2)) & sliding_attacks<BISHOP>(s2, square_bb(s1));
+    else if (pt_aligned(ROOK, s1, s2))
+        b |= sliding_attacks<ROOK  >(s1, square_bb(s2)) & sliding_attacks<ROOK  >(s2, square_bb(s1));
+
+    return b;
+  }
+
+  static bool pt_aligned(PieceType pt, Square s1, Square s2) {
+    return Words::any(pseudo_attacks(pt, s1) & square_bb(s2));
+  }
+
+  /// Tables holds the attack tables of a geometry, filled by init(). The
+  /// engine board keeps its own, possibly folded, BitboardTables instead.
+
+  struct Tables {
+    uint8_t  SquareDistance[SQUARE_NB][SQUARE_NB];
+    Bitboard PawnAttacks[COLOR_NB][SQUARE_NB];
+    Bitboard PseudoAttacks[PIECE_TYPE_NB][SQUARE_NB];
+    Bitboard LineBB[SQUARE_NB][SQUARE_NB];
+    Bitboard BetweenBB[SQUARE_NB][SQUARE_NB];
+  };
+
+  static void init(Tables& t) {
+
+    for (Square s1 = SQ_A1; s1 < SQ_NONE; s1 = Square(s1 + 1))
+    {
+        for (Color c : { WHITE, BLACK })
+            t.PawnAttacks[c][s1] = pawn_attacks(c, s1);
+
+        for (PieceType pt = PAWN; pt < PIECE_TYPE_NB; ++pt)
+            t.PseudoAttacks[pt][s1] = pseudo_attacks(pt, s1);
+
+        for (Square s2 = SQ_A1; s2 < SQ_NONE; s2 = Square(s2 + 1))
+        {
+            t.SquareDistance[s1][s2] = uint8_t(distance(s1, s2));
+            t.LineBB[s1][s2] = line(s1, s2);
+            t.BetweenBB[s1][s2] = between(s1, s2);
+        }
+    }
+  }
+};
+
+/// Board is the geometry the engine plays on
+
+using Board = Geometry<BOARD_FILES, BOARD_RANKS>;
+
+static_assert(std::is_same<Board::Bitboard, Bitboard>::value, "Bitboard must be the word of Board");
+static_assert(   int(Board::SQ_NONE) == int(SQ_NONE) && int(Board::NORTH) == int(NORTH)
+              && int(Board::FILE_LAST) == int(FILE_P) && int(Board::RANK_LAST) == int(RANK_16),
+              "The named values of types.h must be those of Board");
+
+} // namespace Stockfish
+
+#endif // #ifndef GEOMETRY_H_INCLUDED
@@ -13,17 +13,249 @@
   along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
+#include <fstream>
 #include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
 #include "types.h"
+#include "benchmark.h"
+#include "book.h"
 #include "bitboard.h"
+#include "evaluate.h"
+#include "misc.h"
+#include "numa.h"
+#include "position.h"
+#include "server.h"
+#include "tablebase.h"
+#include "tt.h"
+#include "uci.h"
 using namespace std;
 using namespace Stockfish;
 using namespace Bitboards;
 
-int main() {
-    cout << "Hello world!" << endl;
+int main(int argc, char* argv[]) {
     init();
-    std::cout << pretty(RookAttacks(SQ_D3, NoSquares)) << std::endl;
-    std::cout << pretty(BishopAttacks(SQ_D3, NoSquares)) << std::endl;
+    Position::init();
+    Numa::init();
+
+    // The demo output would corrupt the replies of the server mode
+    if (argc == 1)
+    {
+        cout << "Hello world!" << endl;
+        std::cout << pretty(RookAttacks(SQ_D3, NoSquares)) << std::endl;
+        std::cout << pretty(BishopAttacks(SQ_D3, NoSquares)) << std::endl;
+    }
+
+    // Commands given on the command line are run in order
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string cmd = argv[i];
+
+        if (cmd == "bench")
+        {
+            // bench [threads <n>] [hash <mb>] [depth <d>] [nodes <n>] [fens <file>]
+            Benchmark::Options options;
+
+            for ( ; i + 2 < argc; i += 2)
+            {
+                std::string name = argv[i + 1], value = argv[i + 2];
+
+                if (name == "threads")
+                    options.threads = std::max(1, std::stoi(value));
+                else if (name == "hash")
+                    options.hashMb = std::max(1, std::stoi(value));
+                else if (name == "depth")
+                    options.depth = std::max(1, std::stoi(value));
+                else if (name == "nodes")
+                    options.nodes = std::stoull(value);
+                else if (name == "fens")
+                    options.fenFile = value;
+                else
+                    break;
+            }
+
+            Benchmark::bench(std::cout, options);
+        }
+        else if (cmd == "microbench")
+        {
+            int iterations = i + 1 < argc && isdigit(argv[i + 1][0]) ? std::stoi(argv[++i]) : 64;
+            Benchmark::micro(std::cout, iterations);
+        }
+        else if (cmd == "perft")
+        {
+            int depth = i + 1 < argc && isdigit(argv[i + 1][0]) ? std::stoi(argv[++i]) : 3;
+            Benchmark::perft(std::cout, StartFEN, depth);
+        }
+        else if (cmd == "server")
+        {
+            // server [threads <n>] [hash <mb>] [queue <n>] [socket <path>] [tb <dirs>] [hashfile <file>],
+            // takes the rest of the line
+            Server::Options options = { std::max(1U, std::thread::hardware_concurrency()), 64, 1024, "", "" };
+
+            for (++i; i + 1 < argc; i += 2)
+            {
+                std::string name = argv[i], value = argv[i + 1];
+
+                if (name == "threads")
+                    options.threads = std::max(1, std::stoi(value));
+                else if (name == "hash")
+                    options.hashMb = std::max(1, std::stoi(value));
+                else if (name == "queue")
+                    options.queue = std::max(1, std::stoi(value));
+                else if (name == "socket")
+                    options.socketPath = value;
+                else if (name == "tb")
+                    Tablebases::init(value);
+                else if (name == "hashfile")
+                    options.hashFile = value;
+                else
+                    std::cout << "Unknown server option: " << name << std::endl;
+            }
+
+            Server::run(options);
+        }
+        else if (cmd == "makebook" && i + 2 < argc)
+        {
+            // makebook <games> <book> [plies <n>] [memory <mb>]
+            std::string games = argv[++i], book = argv[++i];
+            int plies = 32, memory = 256;
+
+            while (i + 2 < argc && (argv[i + 1] == std::string("plies") || argv[i + 1] == std::string("memory")))
+            {
+                int& option = argv[i + 1] == std::string("plies") ? plies : memory;
+                option = std::max(1, std::stoi(argv[i + 2]));
+                i += 2;
+            }
+
+            Book::build(games, book, plies, memory, std::cout);
+        }
+        else if (cmd == "book" && i + 1 < argc)
+        {
+            // book <book> ["<fen>"], lists the book moves of the position
+            std::string path = argv[++i];
+            std::string fen = i + 1 < argc && std::string(argv[i + 1]).find('/') != std::string::npos ? argv[++i] : StartFEN;
+            Book book;
+            StateInfo st;
+            Position pos;
+
+            if (!Position::valid_fen(fen))
+                std::cout << "Invalid fen: " << fen << std::endl;
+            else if (!book.open(path))
+                std::cout << "Cannot open book " << path << std::endl;
+            else
+            {
+                pos.set(fen, &st);
+                auto [first, last] = book.probe(pos.key());
+                std::cout << book.size() << " entries, " << last - first << " for this position" << std::endl;
+                for (const BookEntry* e = first; e != last; ++e)
+                    std::cout << UCI::move(Move(e->move)) << " weight " << e->weight << " learn " << e->learn << std::endl;
+                std::cout << "Book move: " << UCI::move(book.probe(pos, true)) << std::endl;
+            }
+        }
+        else if (cmd == "score" && i + 1 < argc)
+        {
+            // score <fens>, prints the static evaluation of each line of the file,
+            // reading the file by chunks that are evaluated as one batch
+            constexpr size_t ChunkSize = 4096;
+            std::ifstream file(argv[++i]);
+            std::vector<StateInfo> states(ChunkSize);
+            std::vector<Position> positions(ChunkSize);
+            std::vector<const Position*> batch;
+            std::vector<std::string> fens;
+            Value values[ChunkSize];
+            std::string fen;
+
+            while (file)
+            {
+                fens.clear();
+                batch.clear();
+
+                while (fens.size() < ChunkSize && std::getline(file, fen))
+                    if (Position::valid_fen(fen))
+                    {
+                        batch.push_back(&positions[fens.size()].set(fen, &states[fens.size()]));
+                        fens.push_back(fen);
+                    }
+                    else if (!fen.empty())
+                        std::cout << "Invalid fen: " << fen << "\n";
+
+                Eval::evaluate(batch.data(), batch.size(), values);
+
+                for (size_t k = 0; k < fens.size(); ++k)
+                    std::cout << fens[k] << " score " << UCI::value(values[k]) << "\n";
+            }
+            std::cout << std::flush;
+        }
+        else if (cmd == "hashmerge" && i + 2 < argc)
+        {
+            // hashmerge <out> <in> [<in> ...], takes the rest of the line. Merges
+            // hash files of tables of the same size, all of them verified.
+            std::string out = argv[++i];
+            bool ok = TT.load(argv[++i], true);
+
+            while (ok && i + 1 < argc)
+                ok = TT.merge(argv[++i]);
+
+            if (ok && TT.save(out))
+                std::cout << "Merged into " << out << std::endl;
+
+            i = argc;
+        }
+        else if (cmd == "tbgen" && i + 1 < argc)
+        {
+            // tbgen <material> [dir <dir>] [threads <n>] [memory <mb>]
+            std::string material = argv[++i], dir = ".";
+            size_t threads = std::max(1U, std::thread::hardware_concurrency()), memory = 4096;
+
+            for ( ; i + 2 < argc; i += 2)
+            {
+                std::string name = argv[i + 1], value = argv[i + 2];
+
+                if (name == "dir")
+                    dir = value;
+                else if (name == "threads")
+                    threads = std::max(1, std::stoi(value));
+                else if (name == "memory")
+                    memory = std::max(1, std::stoi(value));
+                else
+                    break;
+            }
+
+            Tablebases::init(dir);
+            Tablebases::generate(material, dir, threads, memory, std::cout);
+        }
+        else if (cmd == "tbprobe" && i + 1 < argc)
+        {
+            // tbprobe <dirs> ["<fen>"], prints the tablebase values of the position
+            Tablebases::init(argv[++i]);
+            std::string fen = i + 1 < argc && std::string(argv[i + 1]).find('/') != std::string::npos ? argv[++i] : StartFEN;
+            Tablebases::ProbeState result;
+            StateInfo st;
+            Position pos;
+
+            if (!Position::valid_fen(fen))
+                std::cout << "Invalid fen: " << fen << std::endl;
+            else
+            {
+                pos.set(fen, &st);
+                Tablebases::WDLScore wdl = Tablebases::probe_wdl(pos, &result);
+                int dtz = Tablebases::probe_dtz(pos, &result);
+
+                if (result == Tablebases::FAIL)
+                    std::cout << "No table for this position" << std::endl;
+                else
+                    std::cout << "WDL " << (wdl == Tablebases::WDLWin ? "win" : wdl == Tablebases::WDLLoss ? "loss" : "draw")
+                              << ", DTZ " << dtz << std::endl;
+            }
+        }
+        else if (cmd == "numa")
+            Numa::print_topology(std::cout);
+        else if (cmd == "stats")
+            Instrument::dump(std::cout);
+        else
+            std::cout << "Unknown command: " << cmd << std::endl;
+    }
     return 0;
 }
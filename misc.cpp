@@ -0,0 +1,151 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2022 The Stockfish developers (see AUTHORS file)
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <iomanip>
+
+#include "misc.h"
+
+namespace Stockfish {
+
+namespace Instrument {
+
+namespace {
+
+  std::atomic<ThreadStats*> Head;
+  std::atomic<TimePoint> StartTime(now());
+
+  // Totals at the time of the last reset(), subtracted by dump()
+  uint64_t BaseCounters[COUNTER_NB], BaseCalls[TIMER_NB], BaseCycles[TIMER_NB];
+
+  const char* CounterNames[COUNTER_NB] = {
+    "rook attacks", "bishop attacks", "lsb (all scans)", "pop_lsb", "BetweenBB", "LineBB",
+    "TT probes", "TT hits"
+  };
+
+  const char* TimerNames[TIMER_NB] = { "Bitboards::init", "slider attacks" };
+
+  // A subsystem is reported as a total, then counter by counter. The total
+  // is the sum of the counters unless one of them already counts all the
+  // events of the others: every pop_lsb() is also an lsb(), every hit is also
+  // a probe. For the hash table the hit rate follows, hits over probes.
+  constexpr int SUM = COUNTER_NB;
+
+  struct Subsystem { const char* name; Counter first, last; int total; bool hitRate; };
+
+  const Subsystem Subsystems[] = {
+    { "Slider attacks",  ROOK_ATTACKS,    BISHOP_ATTACKS, SUM,       false },
+    { "Bit scans",       LSB,             POP_LSB,        LSB,       false },
+    { "Geometry tables", BETWEEN_LOOKUPS, LINE_LOOKUPS,   SUM,       false },
+    { "Hash table",      TT_PROBES,       TT_HITS,        TT_PROBES, true  }
+  };
+
+  void totals(uint64_t counters[], uint64_t calls[], uint64_t cycles[]) {
+
+    std::fill_n(counters, COUNTER_NB, 0);
+    std::fill_n(calls, TIMER_NB, 0);
+    std::fill_n(cycles, TIMER_NB, 0);
+
+    for (ThreadStats* s = Head.load(std::memory_order_acquire); s; s = s->next)
+    {
+        for (int i = 0; i < COUNTER_NB; ++i)
+            counters[i] += s->counters[i].load(std::memory_order_relaxed);
+
+        for (int i = 0; i < TIMER_NB; ++i)
+        {
+            calls[i]  += s->calls[i].load(std::memory_order_relaxed);
+            cycles[i] += s->cycles[i].load(std::memory_order_relaxed);
+        }
+    }
+  }
+
+} // namespace
+
+
+/// register_thread() allocates the counter block of the calling thread and
+/// pushes it on the global list. Blocks are intentionally never freed.
+
+ThreadStats* register_thread() {
+
+  ThreadStats* s = new ThreadStats();
+  s->next = Head.load(std::memory_order_relaxed);
+  while (!Head.compare_exchange_weak(s->next, s, std::memory_order_release))
+  {}
+  return s;
+}
+
+
+/// reset() makes the following dump() report only what happened from now on.
+/// It does not touch the per-thread blocks, so it is safe while others count.
+
+void reset() {
+
+  totals(BaseCounters, BaseCalls, BaseCycles);
+  StartTime = now();
+}
+
+
+/// dump() prints the totals of all the threads, grouped by subsystem, along
+/// with the rate per second since program start or the last reset().
+
+void dump(std::ostream& os) {
+
+#ifndef USE_INSTRUMENTATION
+  os << "info string instrumentation disabled, rebuild with -DUSE_INSTRUMENTATION\n";
+#endif
+
+  uint64_t counters[COUNTER_NB], calls[TIMER_NB], cycles[TIMER_NB];
+  totals(counters, calls, cycles);
+
+  double elapsed = std::max(TimePoint(1), now() - StartTime) / 1000.0;
+
+  os << "Elapsed " << std::fixed << std::setprecision(3) << elapsed << " s\n";
+
+  for (const Subsystem& sub : Subsystems)
+  {
+      uint64_t sum = 0;
+      for (int i = sub.first; i <= sub.last; ++i)
+          if (sub.total == SUM || sub.total == i)
+              sum += counters[i] - BaseCounters[i];
+
+      os << sub.name << ": " << sum << " (" << uint64_t(sum / elapsed) << "/s)\n";
+
+      for (int i = sub.first; i <= sub.last; ++i)
+      {
+          uint64_t n = counters[i] - BaseCounters[i];
+          os << "  " << std::left << std::setw(16) << CounterNames[i] << std::right
+             << std::setw(16) << n << std::setw(16) << uint64_t(n / elapsed) << "/s\n";
+      }
+
+      if (sub.hitRate)
+          os << "  " << std::left << std::setw(16) << "hit rate" << std::right << std::setw(15)
+             << std::setprecision(1) << 100.0 * (counters[sub.last] - BaseCounters[sub.last]) / std::max(sum, uint64_t(1)) << "%\n";
+  }
+
+  os << "Timers:\n";
+  for (int i = 0; i < TIMER_NB; ++i)
+  {
+      uint64_t n = calls[i] - BaseCalls[i], c = cycles[i] - BaseCycles[i];
+      os << "  " << std::left << std::setw(16) << TimerNames[i] << std::right
+         << std::setw(16) << n << " calls" << std::setw(16) << c << " cycles"
+         << std::setw(12) << (n ? c / n : 0) << " cycles/call\n";
+  }
+
+  os << std::flush;
+}
+
+} // namespace Instrument
+
+} // namespace Stockfish
@@ -0,0 +1,137 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2022 The Stockfish developers (see AUTHORS file)
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MISC_H_INCLUDED
+#define MISC_H_INCLUDED
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace Stockfish {
+
+using TimePoint = std::chrono::milliseconds::rep; // A value in milliseconds
+static_assert(sizeof(TimePoint) == sizeof(int64_t), "TimePoint should be 64 bits");
+inline TimePoint now() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>
+        (std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/// mul_hi64() returns the upper 64 bits of a 64x64 bit multiplication
+inline uint64_t mul_hi64(uint64_t a, uint64_t b) {
+#if defined(__GNUC__) && defined(__x86_64__)
+  __extension__ typedef unsigned __int128 uint128;
+  return ((uint128)a * (uint128)b) >> 64;
+#else
+  uint64_t aL = (uint32_t)a, aH = a >> 32;
+  uint64_t bL = (uint32_t)b, bH = b >> 32;
+  uint64_t c1 = (aL * bL) >> 32;
+  uint64_t c2 = aH * bL + c1;
+  uint64_t c3 = aL * bH + (uint32_t)c2;
+  return aH * bH + (c2 >> 32) + (c3 >> 32);
+#endif
+}
+
+/// Instrument namespace holds the hot-path counters. Every thread owns a
+/// cache-line aligned block of counters that only it writes to, so counting
+/// needs neither locks nor atomic read-modify-write instructions. Blocks are
+/// linked into a global list on first use and are never freed, so totals of
+/// finished threads survive. dump() walks the list and sums all the blocks.
+///
+/// Everything compiles to nothing unless USE_INSTRUMENTATION is defined.
+
+namespace Instrument {
+
+enum Counter {
+  ROOK_ATTACKS, BISHOP_ATTACKS,   // slider attack generation
+  LSB, POP_LSB,                   // bit scans
+  BETWEEN_LOOKUPS, LINE_LOOKUPS,  // BetweenBB[] and LineBB[] probes
+  TT_PROBES, TT_HITS,             // transposition table
+  COUNTER_NB
+};
+
+enum Timer {
+  INIT_TIMER, SLIDER_TIMER,
+  TIMER_NB
+};
+
+struct alignas(64) ThreadStats {
+  std::atomic<uint64_t> counters[COUNTER_NB];
+  std::atomic<uint64_t> calls[TIMER_NB];
+  std::atomic<uint64_t> cycles[TIMER_NB];
+  ThreadStats* next;
+};
+
+ThreadStats* register_thread();
+void reset();
+void dump(std::ostream& os);
+
+inline ThreadStats& local() {
+  thread_local ThreadStats* stats = register_thread();
+  return *stats;
+}
+
+// Only the owning thread writes its block, so a relaxed load followed by a
+// relaxed store is enough and avoids a locked instruction on x86.
+inline void add(std::atomic<uint64_t>& c, uint64_t v) {
+  c.store(c.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+}
+
+inline void count(Counter c) { add(local().counters[c], 1); }
+
+inline uint64_t cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>
+        (std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+/// ScopedTimer adds the cycles spent in its scope to the given timer
+
+class ScopedTimer {
+  Timer timer;
+  uint64_t start;
+
+public:
+  explicit ScopedTimer(Timer t) : timer(t), start(cycles()) {}
+  ~ScopedTimer() {
+    ThreadStats& s = local();
+    add(s.calls[timer], 1);
+    add(s.cycles[timer], cycles() - start);
+  }
+};
+
+} // namespace Instrument
+
+#ifdef USE_INSTRUMENTATION
+#  define INSTRUMENT_CONCAT_(a, b) a##b
+#  define INSTRUMENT_CONCAT(a, b) INSTRUMENT_CONCAT_(a, b)
+#  define INSTRUMENT_COUNT(c) Instrument::count(Instrument::c)
+#  define INSTRUMENT_SCOPE(t) Instrument::ScopedTimer INSTRUMENT_CONCAT(instrumentScope, __LINE__)(Instrument::t)
+#else
+#  define INSTRUMENT_COUNT(c) ((void)0)
+#  define INSTRUMENT_SCOPE(t)
+#endif
+
+} // namespace Stockfish
+
+#endif // #ifndef MISC_H_INCLUDED
@@ -0,0 +1,218 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2022 The Stockfish developers (see AUTHORS file)
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cassert>
+
+#include "movegen.h"
+#include "position.h"
+
+namespace Stockfish {
+
+namespace {
+
+  template<GenType Type, Direction D>
+  ExtMove* make_promotions(ExtMove* moveList, Square to) {
+
+    if (Type == CAPTURES || Type == NON_EVASIONS)
+        *moveList++ = make<PROMOTION>(to - D, to, QUEEN);
+
+    if (Type == QUIETS || Type == NON_EVASIONS)
+    {
+        *moveList++ = make<PROMOTION>(to - D, to, ROOK);
+        *moveList++ = make<PROMOTION>(to - D, to, BISHOP);
+        *moveList++ = make<PROMOTION>(to - D, to, KNIGHT);
+    }
+
+    return moveList;
+  }
+
+
+  template<Color Us, GenType Type>
+  ExtMove* generate_pawn_moves(const Position& pos, ExtMove* moveList, Bitboard target) {
+
+    constexpr Color     Them     = ~Us;
+    constexpr Bitboard  TRank15BB = (Us == WHITE ? Rank15BB : Rank2BB);
+    constexpr Bitboard  TRank3BB  = (Us == WHITE ? Rank3BB  : Rank14BB);
+    constexpr Direction Up       = pawn_push(Us);
+    constexpr Direction UpRight  = (Us == WHITE ? NORTH_EAST : SOUTH_WEST);
+    constexpr Direction UpLeft   = (Us == WHITE ? NORTH_WEST : SOUTH_EAST);
+
+    const Bitboard emptySquares = ~pos.pieces();
+    const Bitboard enemies      = pos.pieces(Them) & target;
+
+    Bitboard pawnsOn15    = pos.pieces(Us, PAWN) &  TRank15BB;
+    Bitboard pawnsNotOn15 = pos.pieces(Us, PAWN) & ~TRank15BB;
+
+    // Single and double pawn pushes, no promotions
+    if (Type != CAPTURES)
+    {
+        Bitboard b1 = shift<Up>(pawnsNotOn15)   & emptySquares;
+        Bitboard b2 = shift<Up>(b1 & TRank3BB) & emptySquares;
+
+        b1 &= target;
+        b2 &= target;
+
+        while (nonemptyBB(b1))
+        {
+            Square to = pop_lsb(b1);
+            *moveList++ = make_move(to - Up, to);
+        }
+
+        while (nonemptyBB(b2))
+        {
+            Square to = pop_lsb(b2);
+            *moveList++ = make_move(to - Up - Up, to);
+        }
+    }
+
+    // Promotions and underpromotions
+    if (nonemptyBB(pawnsOn15))
+    {
+        Bitboard b1 = shift<UpRight>(pawnsOn15) & enemies;
+        Bitboard b2 = shift<UpLeft >(pawnsOn15) & enemies;
+        Bitboard b3 = shift<Up     >(pawnsOn15) & emptySquares;
+
+        while (nonemptyBB(b1))
+            moveList = make_promotions<Type, UpRight>(moveList, pop_lsb(b1));
+
+        while (nonemptyBB(b2))
+            moveList = make_promotions<Type, UpLeft >(moveList, pop_lsb(b2));
+
+        while (nonemptyBB(b3))
+            moveList = make_promotions<Type, Up     >(moveList, pop_lsb(b3));
+    }
+
+    // Standard and en passant captures
+    if (Type == CAPTURES || Type == NON_EVASIONS)
+    {
+        Bitboard b1 = shift<UpRight>(pawnsNotOn15) & enemies;
+        Bitboard b2 = shift<UpLeft >(pawnsNotOn15) & enemies;
+
+        while (nonemptyBB(b1))
+        {
+            Square to = pop_lsb(b1);
+            *moveList++ = make_move(to - UpRight, to);
+        }
+
+        while (nonemptyBB(b2))
+        {
+            Square to = pop_lsb(b2);
+            *moveList++ = make_move(to - UpLeft, to);
+        }
+
+        if (pos.ep_square() != SQ_NONE)
+        {
+            assert(rank_of(pos.ep_square()) == relative_rank(Us, RANK_14));
+
+            b1 = pawnsNotOn15 & pawn_attacks_bb(Them, pos.ep_square());
+
+            assert(nonemptyBB(b1));
+
+            while (nonemptyBB(b1))
+                *moveList++ = make<EN_PASSANT>(pop_lsb(b1), pos.ep_square());
+        }
+    }
+
+    return moveList;
+  }
+
+
+  template<Color Us, PieceType Pt>
+  ExtMove* generate_moves(const Position& pos, ExtMove* moveList, Bitboard target) {
+
+    static_assert(Pt != KING && Pt != PAWN, "Unsupported piece type in generate_moves()");
+
+    Bitboard bb = pos.pieces(Us, Pt);
+
+    while (nonemptyBB(bb))
+    {
+        Square from = pop_lsb(bb);
+        Bitboard b = attacks_bb<Pt>(from, pos.pieces()) & target;
+
+        while (nonemptyBB(b))
+            *moveList++ = make_move(from, pop_lsb(b));
+    }
+
+    return moveList;
+  }
+
+
+  template<Color Us, GenType Type>
+  ExtMove* generate_all(const Position& pos, ExtMove* moveList) {
+
+    const Square ksq = pos.square<KING>(Us);
+    const Bitboard target = Type == CAPTURES ? pos.pieces(~Us)
+                          : Type == QUIETS   ? ~pos.pieces()
+                                             : ~pos.pieces(Us);
+
+    moveList = generate_pawn_moves<Us, Type>(pos, moveList, target);
+    moveList = generate_moves<Us, KNIGHT>(pos, moveList, target);
+    moveList = generate_moves<Us, BISHOP>(pos, moveList, target);
+    moveList = generate_moves<Us,   ROOK>(pos, moveList, target);
+    moveList = generate_moves<Us,  QUEEN>(pos, moveList, target);
+
+    Bitboard b = attacks_bb<KING>(ksq) & target;
+    while (nonemptyBB(b))
+        *moveList++ = make_move(ksq, pop_lsb(b));
+
+    return moveList;
+  }
+
+} // namespace
+
+
+/// <CAPTURES>     Generates all pseudo-legal captures plus queen promotions
+/// <QUIETS>       Generates all pseudo-legal non-captures and underpromotions
+/// <NON_EVASIONS> Generates all pseudo-legal captures and non-captures
+///
+/// Returns a pointer to the end of the move list. There are no evasion
+/// generators, positions in check are handled by filtering with legal().
+
+template<GenType Type>
+ExtMove* generate(const Position& pos, ExtMove* moveList) {
+
+  static_assert(Type != LEGAL, "Unsupported type in generate()");
+
+  Color us = pos.side_to_move();
+
+  return us == WHITE ? generate_all<WHITE, Type>(pos, moveList)
+                     : generate_all<BLACK, Type>(pos, moveList);
+}
+
+// Explicit template instantiations
+template ExtMove* generate<CAPTURES>(const Position&, ExtMove*);
+template ExtMove* generate<QUIETS>(const Position&, ExtMove*);
+template ExtMove* generate<NON_EVASIONS>(const Position&, ExtMove*);
+
+
+/// generate<LEGAL> generates all the legal moves in the given position
+
+template<>
+ExtMove* generate<LEGAL>(const Position& pos, ExtMove* moveList) {
+
+  ExtMove* cur = moveList;
+
+  moveList = generate<NON_EVASIONS>(pos, moveList);
+
+  while (cur != moveList)
+      if (!pos.legal(*cur))
+          *cur = (--moveList)->move;
+      else
+          ++cur;
+
+  return moveList;
+}
+
+} // namespace Stockfish
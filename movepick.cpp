@@ -0,0 +1,231 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2022 The Stockfish developers (see AUTHORS file)
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <cassert>
+#include <iterator>
+#include <limits>
+
+#include "movepick.h"
+
+namespace Stockfish {
+
+namespace {
+
+  enum Stages {
+    MAIN_TT, CAPTURE_INIT, GOOD_CAPTURE, REFUTATION, QUIET_INIT, QUIET, BAD_CAPTURE,
+    EVASION_TT, EVASION_INIT, EVASION,
+    QCAPTURE_INIT, QCAPTURE
+  };
+
+  // partial_insertion_sort() sorts moves in descending order up to and including
+  // a given limit. The order of moves smaller than the limit is left unspecified.
+  void partial_insertion_sort(ExtMove* begin, ExtMove* end, int limit) {
+
+    for (ExtMove *sortedEnd = begin, *p = begin + 1; p < end; ++p)
+        if (p->value >= limit)
+        {
+            ExtMove tmp = *p, *q;
+            *p = *++sortedEnd;
+            for (q = sortedEnd; q != begin && *(q - 1) < tmp; --q)
+                *q = *(q - 1);
+            *q = tmp;
+        }
+  }
+
+} // namespace
+
+
+/// Constructors of the MovePicker class. As arguments we pass information
+/// to help it to return the (presumably) good moves first, to decide which
+/// moves to return (in the quiescence search, for instance, we only want to
+/// search captures, promotions, and some checks) and how important good move
+/// ordering is at the current node.
+
+/// MovePicker constructor for the main search
+MovePicker::MovePicker(const Position& p, Move ttm, Depth d, const ButterflyHistory* mh,
+                       const Move* killers, Move cm)
+           : pos(p), mainHistory(mh), ttMove(ttm), refutations{{killers[0], 0}, {killers[1], 0}, {cm, 0}},
+             depth(d) {
+
+  assert(d > 0);
+
+  stage = (nonemptyBB(pos.checkers()) ? EVASION_TT : MAIN_TT) +
+          !(ttm && pos.pseudo_legal(ttm));
+}
+
+/// MovePicker constructor for quiescence search: the captures, or every move
+/// when in check
+MovePicker::MovePicker(const Position& p, const ButterflyHistory* mh)
+           : pos(p), mainHistory(mh), ttMove(MOVE_NONE), refutations{}, depth(0) {
+
+  stage = nonemptyBB(pos.checkers()) ? EVASION_INIT : QCAPTURE_INIT;
+}
+
+
+/// MovePicker::score() assigns a numerical value to each move in a list, used
+/// for sorting. Captures are ordered by Most Valuable Victim (MVV), preferring
+/// captures with lower valued attackers (LVA), quiets by their history.
+template<GenType Type>
+void MovePicker::score() {
+
+  static_assert(Type == CAPTURES || Type == QUIETS || Type == NON_EVASIONS, "Wrong type");
+
+  for (auto& m : *this)
+      if constexpr (Type == CAPTURES)
+          m.value =  8 * int(PieceValue[MG][pos.piece_on(to_sq(m))])
+                   - type_of(pos.moved_piece(m));
+
+      else if constexpr (Type == QUIETS)
+          m.value = mainHistory->get(pos.side_to_move(), m);
+
+      else // Type == NON_EVASIONS, in check
+      {
+          if (pos.capture_stage(m))
+              m.value =  8 * int(PieceValue[MG][pos.piece_on(to_sq(m))])
+                       - type_of(pos.moved_piece(m))
+                       + (1 << 28);
+          else
+              m.value = mainHistory->get(pos.side_to_move(), m);
+      }
+}
+
+/// MovePicker::select() returns the next move satisfying a predicate function.
+/// It never returns the TT move, which is returned by its own stage.
+template<MovePicker::PickType T, typename Pred>
+Move MovePicker::select(Pred filter) {
+
+  while (cur < endMoves)
+  {
+      if (T == Best)
+          std::swap(*cur, *std::max_element(cur, endMoves));
+
+      if (*cur != ttMove && filter())
+          return *cur++;
+
+      cur++;
+  }
+  return MOVE_NONE;
+}
+
+/// MovePicker::next_move() is the most important method of the MovePicker class. It
+/// returns a new pseudo-legal move every time it is called until there are no more
+/// moves left, picking the move with the highest score from a list of generated moves.
+Move MovePicker::next_move() {
+
+top:
+  switch (stage) {
+
+  case MAIN_TT:
+  case EVASION_TT:
+      ++stage;
+      pickStage = PICK_TT;
+      return ttMove;
+
+  case CAPTURE_INIT:
+  case QCAPTURE_INIT:
+      cur = endBadCaptures = moves;
+      endMoves = generate<CAPTURES>(pos, cur);
+
+      score<CAPTURES>();
+      partial_insertion_sort(cur, endMoves, std::numeric_limits<int>::min());
+      ++stage;
+      goto top;
+
+  case GOOD_CAPTURE:
+      pickStage = PICK_GOOD_CAPTURE;
+
+      // The exchange is only evaluated when the capture comes up, the losing
+      // ones are moved to the front of the list for the BAD_CAPTURE stage.
+      if (select<Next>([&](){ return pos.see_ge(*cur) ? true : (*endBadCaptures++ = *cur, false); }))
+          return *(cur - 1);
+
+      // Prepare the pointers to loop over the refutations array
+      cur = std::begin(refutations);
+      endMoves = std::end(refutations);
+
+      // If the countermove is the same as a killer, skip it
+      if (   refutations[0].move == refutations[2].move
+          || refutations[1].move == refutations[2].move)
+          --endMoves;
+
+      ++stage;
+      [[fallthrough]];
+
+  case REFUTATION:
+      if (select<Next>([&](){ return    *cur != MOVE_NONE
+                                    && !pos.capture_stage(*cur)
+                                    &&  pos.pseudo_legal(*cur); }))
+      {
+          pickStage = cur - 1 == &refutations[2] ? PICK_COUNTERMOVE : PICK_KILLER;
+          return *(cur - 1);
+      }
+      ++stage;
+      [[fallthrough]];
+
+  case QUIET_INIT:
+      cur = endBadCaptures;
+      endMoves = generate<QUIETS>(pos, cur);
+
+      score<QUIETS>();
+      partial_insertion_sort(cur, endMoves, -3000 * depth);
+
+      ++stage;
+      [[fallthrough]];
+
+  case QUIET:
+      pickStage = PICK_QUIET;
+
+      if (select<Next>([&](){ return   *cur != refutations[0].move
+                                    && *cur != refutations[1].move
+                                    && *cur != refutations[2].move; }))
+          return *(cur - 1);
+
+      // Prepare the pointers to loop over the bad captures
+      cur = moves;
+      endMoves = endBadCaptures;
+
+      ++stage;
+      [[fallthrough]];
+
+  case BAD_CAPTURE:
+      pickStage = PICK_BAD_CAPTURE;
+      return select<Next>([](){ return true; });
+
+  case EVASION_INIT:
+      cur = moves;
+      endMoves = generate<NON_EVASIONS>(pos, cur);
+
+      // Every pseudo-legal move is generated, so sort them once rather than
+      // searching the best one at each pick
+      score<NON_EVASIONS>();
+      partial_insertion_sort(cur, endMoves, std::numeric_limits<int>::min());
+      ++stage;
+      [[fallthrough]];
+
+  case EVASION:
+      pickStage = PICK_EVASION;
+      return select<Next>([](){ return true; });
+
+  case QCAPTURE:
+      pickStage = PICK_GOOD_CAPTURE;
+      return select<Next>([](){ return true; });
+  }
+
+  assert(false);
+  return MOVE_NONE; // Silence warning
+}
+
+} // namespace Stockfish
@@ -0,0 +1,101 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2022 The Stockfish developers (see AUTHORS file)
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef MOVEPICK_H_INCLUDED
+#define MOVEPICK_H_INCLUDED
+
+#include <cstdint>
+#include <cstdlib>
+
+#include "movegen.h"
+#include "position.h"
+#include "types.h"
+
+namespace Stockfish {
+
+/// ButterflyHistory records how often quiet moves have been successful or
+/// unsuccessful during the current search, and is used for reduction and move
+/// ordering decisions. It is indexed by the side to move and the from and to
+/// squares of the move (see from_to()). update() keeps entries in [-D, D].
+
+struct ButterflyHistory {
+
+  static constexpr int D = 8192;
+
+  int16_t table[COLOR_NB][1 << 16];
+
+  int get(Color c, Move m) const { return table[c][from_to(m)]; }
+
+  void update(Color c, Move m, int bonus) {
+    assert(std::abs(bonus) <= D); // Ensure range is [-D, D]
+    int16_t& entry = table[c][from_to(m)];
+    entry += bonus - entry * std::abs(bonus) / D;
+  }
+};
+
+/// CounterMoves stores the quiet move that refuted a move, indexed by the
+/// piece and the destination square of the refuted move.
+
+using CounterMoves = Move[PIECE_NB][SQUARE_NB];
+
+/// PickStage tells from which stage the last move returned by a MovePicker
+/// came, for the cutoff statistics of the search.
+
+enum PickStage {
+  PICK_TT, PICK_GOOD_CAPTURE, PICK_KILLER, PICK_COUNTERMOVE, PICK_QUIET, PICK_BAD_CAPTURE, PICK_EVASION,
+  PICK_STAGE_NB
+};
+
+/// MovePicker class is used to pick one pseudo-legal move at a time from the
+/// current position. The most important method is next_move(), which returns
+/// a new pseudo-legal move each time it is called, until there are no moves
+/// left, when MOVE_NONE is returned. In order to improve the efficiency of the
+/// alpha-beta algorithm, MovePicker attempts to return the moves which are
+/// most likely to get a cut-off first. On a board of 256 squares a list holds
+/// hundreds of moves, so each stage generates and scores its moves only when
+/// it is reached, and the quiet moves are only partially sorted.
+
+class MovePicker {
+
+  enum PickType { Next, Best };
+
+public:
+  MovePicker(const MovePicker&) = delete;
+  MovePicker& operator=(const MovePicker&) = delete;
+  MovePicker(const Position&, Move, Depth, const ButterflyHistory*, const Move* killers, Move counterMove);
+  MovePicker(const Position&, const ButterflyHistory*);
+  Move next_move();
+  PickStage picked() const { return pickStage; }
+
+private:
+  template<PickType T, typename Pred> Move select(Pred);
+  template<GenType> void score();
+  ExtMove* begin() { return cur; }
+  ExtMove* end() { return endMoves; }
+
+  const Position& pos;
+  const ButterflyHistory* mainHistory;
+  Move ttMove;
+  ExtMove refutations[3], *cur, *endMoves, *endBadCaptures;
+  int stage;
+  PickStage pickStage;
+  Depth depth;
+  ExtMove moves[MAX_MOVES];
+};
+
+} // namespace Stockfish
+
+#endif // #ifndef MOVEPICK_H_INCLUDED
@@ -0,0 +1,243 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2022 The Stockfish developers (see AUTHORS file)
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "bitboard.h"
+#include "numa.h"
+
+namespace Stockfish {
+
+namespace {
+
+  struct Node {
+    int id;
+    std::vector<int> cpus;
+  };
+
+  std::vector<Node> Nodes;
+  std::vector<const BitboardTables*> Replicas;
+
+  // Memory policies of mbind(), see <numaif.h>, which we do not depend on
+  constexpr int MPOL_BIND_       = 2;
+  constexpr int MPOL_INTERLEAVE_ = 3;
+
+  // parse_cpulist() reads the sysfs format, e.g. "0-7,16-23"
+  std::vector<int> parse_cpulist(const std::string& list) {
+
+    std::vector<int> cpus;
+    std::istringstream ss(list);
+    std::string range;
+
+    while (std::getline(ss, range, ','))
+    {
+        if (range.empty() || !isdigit(range[0]))
+            continue;
+
+        size_t dash = range.find('-');
+        int first = std::stoi(range);
+        int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+
+        for (int cpu = first; cpu <= last; ++cpu)
+            cpus.push_back(cpu);
+    }
+    return cpus;
+  }
+
+  void detect_nodes() {
+
+    Nodes.clear();
+
+#ifdef __linux__
+    if (DIR* dir = opendir("/sys/devices/system/node"))
+    {
+        while (dirent* entry = readdir(dir))
+        {
+            if (std::strncmp(entry->d_name, "node", 4) || !isdigit(entry->d_name[4]))
+                continue;
+
+            std::ifstream file(std::string("/sys/devices/system/node/") + entry->d_name + "/cpulist");
+            std::string list;
+
+            if (std::getline(file, list))
+            {
+                Node node = { std::atoi(entry->d_name + 4), parse_cpulist(list) };
+                if (!node.cpus.empty()) // Memory-only nodes run no thread
+                    Nodes.push_back(node);
+            }
+        }
+        closedir(dir);
+    }
+
+    std::sort(Nodes.begin(), Nodes.end(), [](const Node& a, const Node& b) { return a.id < b.id; });
+#endif
+
+    // No sysfs: a single node with all the CPUs
+    if (Nodes.empty())
+    {
+        Node node = { 0, {} };
+        for (unsigned cpu = 0; cpu < std::max(1U, std::thread::hardware_concurrency()); ++cpu)
+            node.cpus.push_back(int(cpu));
+        Nodes.push_back(node);
+    }
+  }
+
+#if defined(USE_NUMA) && defined(__linux__)
+  long mbind(void* addr, size_t len, int mode, const unsigned long* mask, unsigned long maxnode) {
+    return syscall(SYS_mbind, addr, len, mode, mask, maxnode, 0);
+  }
+#endif
+
+  // map_pages() returns zeroed memory placed on the given nodes with the given
+  // policy. The placement is only applied with USE_NUMA, and a failed mbind()
+  // leaves the default first-touch placement.
+  void* map_pages(size_t size, int mode, const std::vector<int>& nodeIds) {
+
+#ifdef __linux__
+    void* mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED)
+        return nullptr;
+
+#if defined(USE_NUMA)
+    unsigned long mask[16] = {};
+    for (int id : nodeIds)
+        if (id < int(sizeof(mask) * 8))
+            mask[id / (8 * sizeof(unsigned long))] |= 1UL << (id % (8 * sizeof(unsigned long)));
+
+    mbind(mem, size, mode, mask, sizeof(mask) * 8);
+#else
+    (void)mode, (void)nodeIds;
+#endif
+    return mem;
+#else
+    (void)mode, (void)nodeIds;
+    return std::calloc(1, size);
+#endif
+  }
+
+} // namespace
+
+
+namespace Numa {
+
+/// Numa::init() detects the topology and, with USE_NUMA and more than one
+/// node, replicates the bitboard tables. Must be called after Bitboards::init().
+
+void init() {
+
+  detect_nodes();
+
+  Replicas.assign(Nodes.size(), &Tables);
+
+#if defined(USE_NUMA)
+  if (Nodes.size() > 1)
+      for (size_t i = 0; i < Nodes.size(); ++i)
+          if (void* mem = map_pages(sizeof(BitboardTables), MPOL_BIND_, { Nodes[i].id }))
+          {
+              std::memcpy(mem, &Tables, sizeof(BitboardTables));
+              Replicas[i] = static_cast<const BitboardTables*>(mem);
+          }
+#else
+  (void)MPOL_BIND_;
+#endif
+}
+
+
+size_t node_count() {
+  return Nodes.size();
+}
+
+
+/// Numa::bind_this_thread() pins the calling thread, the idx-th worker, to
+/// the CPUs of a node, spreading workers round-robin over the nodes, and
+/// switches its bitboard tables to the replica of that node.
+
+void bind_this_thread(size_t idx) {
+
+#if defined(USE_NUMA) && defined(__linux__)
+  if (Nodes.size() <= 1)
+      return;
+
+  size_t node = idx % Nodes.size();
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+
+  for (int cpu : Nodes[node].cpus)
+      if (cpu < CPU_SETSIZE)
+          CPU_SET(cpu, &cpus);
+
+  sched_setaffinity(0, sizeof(cpu_set_t), &cpus);
+  LocalTables = Replicas[node];
+#else
+  (void)idx;
+#endif
+}
+
+
+void print_topology(std::ostream& os) {
+
+  os << "info string " << Nodes.size() << " NUMA node(s)";
+#if !defined(USE_NUMA)
+  os << ", binding and replication disabled, rebuild with -DUSE_NUMA";
+#endif
+  os << "\n";
+
+  for (size_t i = 0; i < Nodes.size(); ++i)
+      os << "info string node " << Nodes[i].id << ": " << Nodes[i].cpus.size() << " CPU(s), tables "
+         << (Replicas[i] != &Tables ? "replicated" : "shared") << "\n";
+
+  os << std::flush;
+}
+
+
+void* alloc_interleaved(size_t size) {
+
+  std::vector<int> ids;
+  for (const Node& n : Nodes)
+      ids.push_back(n.id);
+
+  return map_pages(size, MPOL_INTERLEAVE_, ids);
+}
+
+
+void free_interleaved(void* mem, size_t size) {
+
+#ifdef __linux__
+  if (mem)
+      munmap(mem, size);
+#else
+  (void)size;
+  std::free(mem);
+#endif
+}
+
+} // namespace Numa
+
+} // namespace Stockfish
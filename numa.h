@@ -0,0 +1,50 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2022 The Stockfish developers (see AUTHORS file)
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef NUMA_H_INCLUDED
+#define NUMA_H_INCLUDED
+
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+namespace Stockfish {
+
+/// Numa namespace handles NUMA hosts. init() reads the topology from sysfs
+/// and, when there is more than one node, makes a copy of BitboardTables in
+/// the memory of every node. bind_this_thread() pins a worker to the CPUs of
+/// a node and points its LocalTables at that node's copy, so that geometry
+/// lookups never cross the interconnect. Unless USE_NUMA is defined on Linux
+/// there is no binding, no replica and no placement policy: only the topology
+/// report remains, and alloc_interleaved() is a plain allocation.
+
+namespace Numa {
+
+void init();
+size_t node_count();
+void bind_this_thread(size_t idx);
+void print_topology(std::ostream& os);
+
+// Memory for large shared tables, zeroed: with USE_NUMA, interleaved page by
+// page across all the nodes when possible, so that no single node serves
+// every access, else plain anonymous pages placed on first touch.
+void* alloc_interleaved(size_t size);
+void free_interleaved(void* mem, size_t size);
+
+} // namespace Numa
+
+} // namespace Stockfish
+
+#endif // #ifndef NUMA_H_INCLUDED
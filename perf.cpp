@@ -0,0 +1,176 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2022 The Stockfish developers (see AUTHORS file)
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <iomanip>
+
+#ifdef __linux__
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "perf.h"
+
+namespace Stockfish {
+
+namespace {
+
+  const char* EventNames[PerfCounters::EVENT_NB] = {
+    "cycles", "instructions", "L1d misses", "LLC misses", "branch misses", "dTLB misses"
+  };
+
+#ifdef __linux__
+
+  constexpr uint64_t cache_event(uint64_t cache, uint64_t op, uint64_t result) {
+    return cache | (op << 8) | (result << 16);
+  }
+
+  struct EventConfig { uint32_t type; uint64_t config; };
+
+  const EventConfig Configs[PerfCounters::EVENT_NB] = {
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { PERF_TYPE_HW_CACHE, cache_event(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ,
+                                      PERF_COUNT_HW_CACHE_RESULT_MISS) },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+    { PERF_TYPE_HW_CACHE, cache_event(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ,
+                                      PERF_COUNT_HW_CACHE_RESULT_MISS) }
+  };
+
+  // Events are opened one by one rather than as a group, so that a PMU with
+  // few counters multiplexes them instead of refusing the whole group. The
+  // read values are scaled back by time_enabled / time_running.
+  int open_event(const EventConfig& ec, bool inherit) {
+
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = ec.type;
+    attr.config = ec.config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.inherit = inherit;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    return int(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+  }
+
+#endif
+
+} // namespace
+
+
+PerfCounters::PerfCounters(bool inherit) {
+
+  for (int e = 0; e < EVENT_NB; ++e)
+  {
+#ifdef __linux__
+      fd[e] = open_event(Configs[e], inherit);
+#else
+      (void)inherit;
+      fd[e] = -1;
+#endif
+      values[e] = 0;
+  }
+}
+
+PerfCounters::~PerfCounters() {
+
+#ifdef __linux__
+  for (int e = 0; e < EVENT_NB; ++e)
+      if (fd[e] >= 0)
+          close(fd[e]);
+#endif
+}
+
+bool PerfCounters::any_available() const {
+
+  for (int e = 0; e < EVENT_NB; ++e)
+      if (fd[e] >= 0)
+          return true;
+  return false;
+}
+
+void PerfCounters::start() {
+
+#ifdef __linux__
+  for (int e = 0; e < EVENT_NB; ++e)
+      if (fd[e] >= 0)
+      {
+          ioctl(fd[e], PERF_EVENT_IOC_RESET, 0);
+          ioctl(fd[e], PERF_EVENT_IOC_ENABLE, 0);
+      }
+#endif
+}
+
+void PerfCounters::stop() {
+
+#ifdef __linux__
+  for (int e = 0; e < EVENT_NB; ++e)
+  {
+      values[e] = 0;
+
+      if (fd[e] < 0)
+          continue;
+
+      ioctl(fd[e], PERF_EVENT_IOC_DISABLE, 0);
+
+      uint64_t data[3]; // value, time_enabled, time_running
+      if (read(fd[e], data, sizeof(data)) != sizeof(data) || !data[2])
+          continue;
+
+      values[e] = data[2] < data[1] ? uint64_t(double(data[0]) * data[1] / data[2]) : data[0];
+  }
+#endif
+}
+
+void PerfCounters::report(std::ostream& os, uint64_t ops) const {
+
+  if (!any_available())
+  {
+      os << "  hardware counters unavailable\n";
+      return;
+  }
+
+  std::ios::fmtflags flags = os.flags();
+  os << std::fixed << std::setprecision(2);
+
+  for (int e = 0; e < EVENT_NB; ++e)
+  {
+      os << "  " << std::left << std::setw(16) << EventNames[e] << std::right;
+
+      if (fd[e] < 0)
+          os << std::setw(16) << "n/a";
+      else
+      {
+          os << std::setw(16) << values[e];
+          if (ops)
+              os << std::setw(12) << double(values[e]) / ops << " /op";
+      }
+      os << "\n";
+  }
+
+  if (available(CYCLES) && available(INSTRUCTIONS) && values[CYCLES])
+      os << "  " << std::left << std::setw(16) << "IPC" << std::right
+         << std::setw(16) << double(values[INSTRUCTIONS]) / values[CYCLES] << "\n";
+
+  os.flags(flags);
+}
+
+} // namespace Stockfish
@@ -0,0 +1,61 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2022 The Stockfish developers (see AUTHORS file)
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PERF_H_INCLUDED
+#define PERF_H_INCLUDED
+
+#include <cstdint>
+#include <ostream>
+
+namespace Stockfish {
+
+/// PerfCounters wraps the Linux perf_event_open() hardware counters of the
+/// calling thread. Counters the kernel refuses to open (no PMU, virtualized
+/// host, perf_event_paranoid too high, non-Linux build) are simply reported
+/// as unavailable, so the benchmarks always run. With inherit, the counters
+/// also count the threads the calling thread creates after the constructor,
+/// e.g. the workers of a ThreadPool set up afterwards.
+
+class PerfCounters {
+public:
+  enum Event {
+    CYCLES, INSTRUCTIONS, L1D_MISSES, LLC_MISSES, BRANCH_MISSES, DTLB_MISSES,
+    EVENT_NB
+  };
+
+  explicit PerfCounters(bool inherit = false);
+  ~PerfCounters();
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+
+  void start();
+  void stop();
+
+  bool available(Event e) const { return fd[e] >= 0; }
+  bool any_available() const;
+  uint64_t value(Event e) const { return values[e]; }
+
+  // Prints the counters of the last start()/stop() pair, per operation when
+  // ops is non-zero, followed by IPC if both cycles and instructions exist.
+  void report(std::ostream& os, uint64_t ops = 0) const;
+
+private:
+  int fd[EVENT_NB];
+  uint64_t values[EVENT_NB];
+};
+
+} // namespace Stockfish
+
+#endif // #ifndef PERF_H_INCLUDED
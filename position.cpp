@@ -0,0 +1,920 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2022 The Stockfish developers (see AUTHORS file)
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cstddef>   // For offsetof()
+#include <cassert>
+#include <cstring>   // For std::memset, std::memcpy
+#include <iostream>
+#include <sstream>
+
+#include "movegen.h"
+#include "position.h"
+
+using std::string;
+
+namespace Stockfish {
+
+namespace Zobrist {
+
+  Key psq[PIECE_NB][SQUARE_NB];
+  Key enpassant[FILE_NB];
+  Key side;
+}
+
+/// StartFEN is the initial position: a double row of pieces behind a full
+/// rank of pawns, with a single king per side.
+
+const char* StartFEN = "rnbqrnbqkbnrqbnr/pppppppppppppppp/16/16/16/16/16/16/16/16/16/16/16/16/"
+                       "PPPPPPPPPPPPPPPP/RNBQRNBQKBNRQBNR w - 0 1";
+
+namespace {
+
+const string PieceToChar(" PNBRQK  pnbrqk");
+
+// Marcel van Kervinck's cuckoo algorithm for fast detection of "upcoming
+// repetition" situations. Description of the algorithm in the following paper:
+// https://marcelk.net/2013-04-06/paper/upcoming-rep-v2.pdf
+//
+// On 16x16 there are 28820 reversible moves instead of 3668, hence tables of
+// 2^16 entries, indexed by 16-bit slices of the key, at the same load factor.
+
+constexpr int CuckooSize = 1 << 16;
+
+// First and second hash functions for indexing the cuckoo tables
+inline int H1(Key h) { return h & (CuckooSize - 1); }
+inline int H2(Key h) { return (h >> 16) & (CuckooSize - 1); }
+
+// Cuckoo tables with Zobrist hashes of valid reversible moves, and the moves themselves
+Key cuckoo[CuckooSize];
+Move cuckooMove[CuckooSize];
+
+} // namespace
+
+
+/// operator<<(Position) returns an ASCII representation of the position
+
+std::ostream& operator<<(std::ostream& os, const Position& pos) {
+
+  const string line = "\n +---+---+---+---+---+---+---+---+---+---+---+---+---+---+---+---+\n";
+
+  os << line;
+
+  for (Rank r = RANK_16; r >= RANK_1; --r)
+  {
+      for (File f = FILE_A; f <= FILE_P; ++f)
+          os << " | " << PieceToChar[pos.piece_on(make_square(f, r))];
+
+      os << " | " << (1 + r) << line;
+  }
+
+  os << "   a   b   c   d   e   f   g   h   i   j   k   l   m   n   o   p\n"
+     << "\nFen: " << pos.fen() << std::endl;
+
+  return os;
+}
+
+
+/// Position::init() initializes at startup the various arrays used to compute
+/// hash keys.
+
+void Position::init() {
+
+  PRNG rng(1070372);
+
+  for (Piece pc : { W_PAWN, W_KNIGHT, W_BISHOP, W_ROOK, W_QUEEN, W_KING,
+                    B_PAWN, B_KNIGHT, B_BISHOP, B_ROOK, B_QUEEN, B_KING })
+      for (Square s = SQ_A1; s <= SQ_P16; ++s)
+          Zobrist::psq[pc][s] = rng.rand<Key>();
+
+  for (File f = FILE_A; f <= FILE_P; ++f)
+      Zobrist::enpassant[f] = rng.rand<Key>();
+
+  Zobrist::side = rng.rand<Key>();
+
+  // Prepare the cuckoo tables, from the pseudo attacks of Bitboards::init()
+  std::memset(cuckoo, 0, sizeof(cuckoo));
+  std::memset(cuckooMove, 0, sizeof(cuckooMove));
+  [[maybe_unused]] int count = 0;
+  for (Piece pc : { W_KNIGHT, W_BISHOP, W_ROOK, W_QUEEN, W_KING,
+                    B_KNIGHT, B_BISHOP, B_ROOK, B_QUEEN, B_KING })
+      for (Square s1 = SQ_A1; s1 <= SQ_P16; ++s1)
+          for (Square s2 = Square(s1 + 1); s2 <= SQ_P16; ++s2)
+              if (nonemptyBB(attacks_bb(type_of(pc), s1, NoSquares) & s2))
+              {
+                  Move move = make_move(s1, s2);
+                  Key key = Zobrist::psq[pc][s1] ^ Zobrist::psq[pc][s2] ^ Zobrist::side;
+                  int i = H1(key);
+                  while (true)
+                  {
+                      std::swap(cuckoo[i], key);
+                      std::swap(cuckooMove[i], move);
+                      if (move == MOVE_NONE) // Arrived at empty slot?
+                          break;
+                      i = (i == H1(key)) ? H2(key) : H1(key); // Push victim to alternative slot
+                  }
+                  count++;
+              }
+  assert(count == 28820);
+}
+
+
+/// Position::valid_fen() checks the fields that set() trusts: 16 ranks of 16
+/// squares, known pieces, no pawn on a back rank, a king per side and a side
+/// to move. Input from outside the engine should pass it before set().
+
+bool Position::valid_fen(const string& fenStr) {
+
+  std::istringstream ss(fenStr);
+  string board, side;
+  ss >> board >> side;
+
+  int ranks = 0, files = 0, kings[COLOR_NB] = {};
+
+  for (size_t i = 0; i < board.size(); ++i)
+  {
+      char c = board[i];
+
+      if (c == '/')
+      {
+          if (files != 16)
+              return false;
+          ++ranks, files = 0;
+      }
+      else if (isdigit(c))
+      {
+          int n = c - '0';
+          if (i + 1 < board.size() && isdigit(board[i + 1]))
+              n = 10 * n + (board[++i] - '0');
+          files += n;
+      }
+      else if (c != ' ' && PieceToChar.find(c) != string::npos)
+      {
+          if ((c == 'P' || c == 'p') && (ranks == 0 || ranks == 15))
+              return false;
+          kings[WHITE] += c == 'K';
+          kings[BLACK] += c == 'k';
+          ++files;
+      }
+      else
+          return false;
+
+      if (files > 16)
+          return false;
+  }
+
+  return   ranks == 15 && files == 16
+        && kings[WHITE] == 1 && kings[BLACK] == 1
+        && (side == "w" || side == "b");
+}
+
+
+/// Position::set() initializes the position object with the given FEN string.
+/// This function is not very robust - make sure that input FENs are correct,
+/// this is assumed to be the responsibility of the GUI.
+
+Position& Position::set(const string& fenStr, StateInfo* si) {
+/*
+   A FEN string defines a particular position using only the ASCII character set.
+
+   A FEN string contains five fields separated by a space. The fields are:
+
+   1) Piece placement (from white's perspective). Each rank is described, starting
+      with rank 16 and ending with rank 1. Within each rank, the contents of each
+      square are described from file A through file P. Following the Standard
+      Algebraic Notation (SAN), each piece is identified by a single letter taken
+      from the standard English names. White pieces are designated using upper-case
+      letters ("PNBRQK") whilst Black uses lowercase ("pnbrqk"). Blank squares are
+      noted using a number from 1 to 16 (the number of blank squares), and "/"
+      separates ranks.
+
+   2) Active color. "w" means white moves next, "b" means black.
+
+   3) En passant target square (in algebraic notation). If there's no en passant
+      target square, this is "-".
+
+   4) Halfmove clock. This is the number of halfmoves since the last pawn advance
+      or capture. This is used to determine if a draw can be claimed under the
+      fifty-move rule.
+
+   5) Fullmove number. The number of the full move. It starts at 1, and is
+      incremented after Black's move.
+*/
+
+  unsigned char token;
+  size_t idx;
+  Square sq = SQ_A16;
+  std::istringstream ss(fenStr);
+
+  std::memset(si, 0, sizeof(StateInfo));
+  clear();
+  st = si;
+  ss >> std::noskipws;
+
+  // 1. Piece placement
+  while ((ss >> token) && !isspace(token))
+  {
+      if (isdigit(token))
+      {
+          int n = token - '0';
+          if (isdigit(ss.peek()))
+              n = 10 * n + (ss.get() - '0');
+          sq += n * EAST; // Advance the given number of files
+      }
+
+      else if (token == '/')
+          sq += 2 * SOUTH;
+
+      else if ((idx = PieceToChar.find(token)) != string::npos) {
+          put_piece(Piece(idx), sq);
+          ++sq;
+      }
+  }
+
+  // 2. Active color
+  ss >> token;
+  sideToMove = (token == 'w' ? WHITE : BLACK);
+  ss >> token;
+
+  // 3. En passant square. Ignore if no pawn capture is possible
+  st->epSquare = SQ_NONE;
+  unsigned char col;
+  if ((ss >> col) && col >= 'a' && col <= 'p' && isdigit(ss.peek()))
+  {
+      int row = ss.get() - '0';
+      if (isdigit(ss.peek()))
+          row = 10 * row + (ss.get() - '0');
+
+      if (row >= 1 && row <= 16)
+      {
+          st->epSquare = make_square(File(col - 'a'), Rank(row - 1));
+
+          // En passant square will be considered only if there is a pawn
+          // of the side to move that can capture, and the pushed pawn is
+          // right in front of the en passant square.
+          if (   !nonemptyBB(attackers_to(st->epSquare) & pieces(sideToMove, PAWN))
+              || !is_ok(st->epSquare - pawn_push(sideToMove))
+              || !nonemptyBB(pieces(~sideToMove, PAWN) & (st->epSquare - pawn_push(sideToMove))))
+              st->epSquare = SQ_NONE;
+      }
+  }
+
+  // 4-5. Halfmove clock and fullmove number
+  ss >> std::skipws >> st->rule50 >> gamePly;
+
+  // Convert from fullmove starting from 1 to gamePly starting from 0,
+  // handle also common incorrect FEN with fullmove = 0.
+  gamePly = std::max(2 * (gamePly - 1), 0) + (sideToMove == BLACK);
+
+  set_state(st);
+  attackMap.compute(*this);
+
+  assert(pos_is_ok());
+
+  return *this;
+}
+
+
+/// Position::set_state() computes the hash keys of the position, and other
+/// data that once computed is updated incrementally as moves are made.
+
+void Position::set_state(StateInfo* si) const {
+
+  si->key = 0;
+
+  Bitboard b = pieces();
+  while (nonemptyBB(b))
+  {
+      Square s = pop_lsb(b);
+      si->key ^= Zobrist::psq[piece_on(s)][s];
+  }
+
+  if (si->epSquare != SQ_NONE)
+      si->key ^= Zobrist::enpassant[file_of(si->epSquare)];
+
+  if (sideToMove == BLACK)
+      si->key ^= Zobrist::side;
+}
+
+
+/// Position::fen() returns a FEN representation of the position
+
+string Position::fen() const {
+
+  int emptyCnt;
+  std::ostringstream ss;
+
+  for (Rank r = RANK_16; r >= RANK_1; --r)
+  {
+      for (File f = FILE_A; f <= FILE_P; ++f)
+      {
+          for (emptyCnt = 0; f <= FILE_P && empty(make_square(f, r)); ++f)
+              ++emptyCnt;
+
+          if (emptyCnt)
+              ss << emptyCnt;
+
+          if (f <= FILE_P)
+              ss << PieceToChar[piece_on(make_square(f, r))];
+      }
+
+      if (r > RANK_1)
+          ss << '/';
+  }
+
+  ss << (sideToMove == WHITE ? " w " : " b ");
+
+  if (ep_square() == SQ_NONE)
+      ss << '-';
+  else
+      ss << char('a' + file_of(ep_square())) << 1 + rank_of(ep_square());
+
+  ss << " " << st->rule50 << " " << 1 + (gamePly - (sideToMove == BLACK)) / 2;
+
+  return ss.str();
+}
+
+
+/// Position::clear() erases the position object to a pristine state
+
+void Position::clear() {
+
+  std::memset(this, 0, sizeof(Position));
+}
+
+
+/// Position::attackers_to() computes a bitboard of all pieces which attack a
+/// given square. Slider attacks use the occupied bitboard to indicate occupancy.
+/// The slider generators walk the rays, so they are skipped when no slider
+/// of the matching kind stands on any line through the square.
+
+Bitboard Position::attackers_to(Square s, Bitboard occupied) const {
+
+  Bitboard attackers =  (pawn_attacks_bb(BLACK, s)       & pieces(WHITE, PAWN))
+                      | (pawn_attacks_bb(WHITE, s)       & pieces(BLACK, PAWN))
+                      | (attacks_bb<KNIGHT>(s)           & pieces(KNIGHT))
+                      | (attacks_bb<KING>(s)             & pieces(KING));
+
+  if (nonemptyBB(attacks_bb<ROOK>(s) & pieces(ROOK, QUEEN)))
+      attackers |= attacks_bb<ROOK>(s, occupied) & pieces(ROOK, QUEEN);
+
+  if (nonemptyBB(attacks_bb<BISHOP>(s) & pieces(BISHOP, QUEEN)))
+      attackers |= attacks_bb<BISHOP>(s, occupied) & pieces(BISHOP, QUEEN);
+
+  return attackers;
+}
+
+
+/// Position::legal() tests whether a pseudo-legal move is legal, that is
+/// whether our king is left unattacked once the move has been made. The
+/// captured piece, if any, is masked out of the attackers.
+
+bool Position::legal(Move m) const {
+
+  assert(is_ok(m));
+
+  Color us = sideToMove;
+  Square from = from_sq(m);
+  Square to = to_sq(m);
+  Square capsq = type_of(m) == EN_PASSANT ? to - pawn_push(us) : to;
+
+  assert(color_of(moved_piece(m)) == us);
+
+  Square ksq = type_of(piece_on(from)) == KING ? to : square<KING>(us);
+  Bitboard occupied = (pieces() ^ from ^ capsq) | to;
+
+  return !nonemptyBB(attackers_to(ksq, occupied) & pieces(~us) & ~square_bb(capsq));
+}
+
+
+/// Position::pseudo_legal() takes a random move and tests whether the move is
+/// pseudo legal. It is used to validate moves from TT that can be corrupted
+/// due to SMP concurrent access or hash position key aliasing, and the killer
+/// moves and countermoves, which come from other positions.
+
+bool Position::pseudo_legal(const Move m) const {
+
+  Color us = sideToMove;
+  Square from = from_sq(m);
+  Square to = to_sq(m);
+  Piece pc = moved_piece(m);
+
+  // Use a slower but simpler function for uncommon cases
+  if (type_of(m) != NORMAL)
+      return MoveList<NON_EVASIONS>(*this).contains(m);
+
+  // If the 'from' square is not occupied by a piece belonging to the side to
+  // move, the move is obviously not legal.
+  if (pc == NO_PIECE || color_of(pc) != us)
+      return false;
+
+  // The destination square cannot be occupied by a friendly piece
+  if (nonemptyBB(pieces(us) & to))
+      return false;
+
+  // Handle the special case of a pawn move
+  if (type_of(pc) == PAWN)
+  {
+      // We have already handled promotion moves, so destination
+      // cannot be on the 16th/1st rank.
+      if (nonemptyBB((Rank16BB | Rank1BB) & to))
+          return false;
+
+      if (   !nonemptyBB(pawn_attacks_bb(us, from) & pieces(~us) & to) // Not a capture
+          && !((from + pawn_push(us) == to) && empty(to))               // Not a single push
+          && !(   (from + 2 * pawn_push(us) == to)                      // Not a double push
+               && (relative_rank(us, from) == RANK_2)
+               && empty(to)
+               && empty(to - pawn_push(us))))
+          return false;
+  }
+  else if (!nonemptyBB(attacks_bb(type_of(pc), from, pieces()) & to))
+      return false;
+
+  // Evasions and pins are left to legal(), which tests the king after the move
+  return true;
+}
+
+
+/// Position::do_move() makes a move, and saves all information necessary
+/// to a StateInfo object. The move is assumed to be legal. Pseudo-legal
+/// moves should be filtered out before this function is called.
+
+void Position::do_move(Move m, StateInfo& newSt) {
+
+  assert(is_ok(m));
+  assert(&newSt != st);
+
+  // Copy some fields of the old state to our new StateInfo object except the
+  // ones which are going to be recalculated from scratch anyway and then switch
+  // our state pointer to point to the new (ready to be updated) state.
+  std::memcpy(&newSt, st, offsetof(StateInfo, key));
+  newSt.previous = st;
+  st = &newSt;
+
+  // Increment ply counters. In particular, rule50 will be reset to zero later on
+  // in case of a capture or a pawn move.
+  ++gamePly;
+  ++st->rule50;
+  ++st->pliesFromNull;
+
+  Key k = st->previous->key ^ Zobrist::side;
+
+  Color us = sideToMove;
+  Color them = ~us;
+  Square from = from_sq(m);
+  Square to = to_sq(m);
+  Piece pc = piece_on(from);
+  Piece captured = type_of(m) == EN_PASSANT ? make_piece(them, PAWN) : piece_on(to);
+  Square capsq = to;
+
+  assert(color_of(pc) == us);
+  assert(captured == NO_PIECE || color_of(captured) == them);
+  assert(type_of(captured) != KING);
+
+  if (captured)
+  {
+      if (type_of(m) == EN_PASSANT)
+      {
+          capsq -= pawn_push(us);
+
+          assert(pc == make_piece(us, PAWN));
+          assert(to == st->epSquare);
+          assert(piece_on(to) == NO_PIECE);
+          assert(piece_on(capsq) == make_piece(them, PAWN));
+      }
+
+      remove_piece(capsq);
+
+      // Update hash key
+      k ^= Zobrist::psq[captured][capsq];
+
+      // Reset rule 50 counter
+      st->rule50 = 0;
+  }
+
+  // Update hash key
+  k ^= Zobrist::psq[pc][from] ^ Zobrist::psq[pc][to];
+
+  // Reset en passant square
+  if (st->epSquare != SQ_NONE)
+  {
+      k ^= Zobrist::enpassant[file_of(st->epSquare)];
+      st->epSquare = SQ_NONE;
+  }
+
+  move_piece(from, to);
+
+  // If the moving piece is a pawn do some special extra work
+  if (type_of(pc) == PAWN)
+  {
+      // Set en passant square if the moved pawn can be captured
+      if (   (int(to) ^ int(from)) == 32
+          && nonemptyBB(pawn_attacks_bb(us, to - pawn_push(us)) & pieces(them, PAWN)))
+      {
+          st->epSquare = to - pawn_push(us);
+          k ^= Zobrist::enpassant[file_of(st->epSquare)];
+      }
+
+      else if (type_of(m) == PROMOTION)
+      {
+          Piece promotion = make_piece(us, promotion_type(m));
+
+          assert(relative_rank(us, to) == RANK_16);
+          assert(type_of(promotion) >= KNIGHT && type_of(promotion) <= QUEEN);
+
+          remove_piece(to);
+          put_piece(promotion, to);
+
+          // Update hash key
+          k ^= Zobrist::psq[pc][to] ^ Zobrist::psq[promotion][to];
+      }
+
+      // Reset rule 50 draw counter
+      st->rule50 = 0;
+  }
+
+  // Set capture piece
+  st->capturedPiece = captured;
+
+  // Update the key with the final value
+  st->key = k;
+
+  sideToMove = ~sideToMove;
+
+  // Calculate the repetition info. It is the ply distance from the previous
+  // occurrence of the same position, negative in the 3-fold case, or zero
+  // if the position was not repeated.
+  st->repetition = 0;
+  int end = std::min(st->rule50, st->pliesFromNull);
+  if (end >= 4)
+  {
+      StateInfo* stp = st->previous->previous;
+      for (int i = 4; i <= end; i += 2)
+      {
+          stp = stp->previous->previous;
+          if (stp->key == st->key)
+          {
+              st->repetition = stp->repetition ? -i : i;
+              break;
+          }
+      }
+  }
+
+  attackMap.update(*this, from | to | capsq);
+
+  assert(pos_is_ok());
+}
+
+
+/// Position::undo_move() unmakes a move. When it returns, the position should
+/// be restored to exactly the same state as before the move was made.
+
+void Position::undo_move(Move m) {
+
+  assert(is_ok(m));
+
+  sideToMove = ~sideToMove;
+
+  Color us = sideToMove;
+  Square from = from_sq(m);
+  Square to = to_sq(m);
+  Square capsq = to;
+
+  assert(empty(from));
+  assert(type_of(st->capturedPiece) != KING);
+
+  if (type_of(m) == PROMOTION)
+  {
+      assert(relative_rank(us, to) == RANK_16);
+      assert(type_of(piece_on(to)) == promotion_type(m));
+
+      remove_piece(to);
+      put_piece(make_piece(us, PAWN), to);
+  }
+
+  move_piece(to, from); // Put the piece back at the source square
+
+  if (st->capturedPiece)
+  {
+      if (type_of(m) == EN_PASSANT)
+      {
+          capsq -= pawn_push(us);
+
+          assert(type_of(piece_on(from)) == PAWN);
+          assert(to == st->previous->epSquare);
+          assert(st->capturedPiece == make_piece(~us, PAWN));
+      }
+
+      put_piece(st->capturedPiece, capsq); // Restore the captured piece
+  }
+
+  // Finally point our state pointer back to the previous state
+  st = st->previous;
+  --gamePly;
+
+  attackMap.update(*this, from | to | capsq);
+
+  assert(pos_is_ok());
+}
+
+
+/// Position::xray() returns the slider, if any, that starts attacking 'to'
+/// once the piece on 'from' has been removed from 'occupied'. Only the line
+/// through both squares can change, so instead of regenerating the slider
+/// attacks of 'to' we look for the nearest piece behind 'from' on that line.
+
+Bitboard Position::xray(Square to, Square from, Bitboard occupied) const {
+
+  Bitboard line = line_bb(to, from);
+
+  if (!nonemptyBB(line)) // Knight, no line through both squares
+      return NoSquares;
+
+  Bitboard sliders =  file_of(to) == file_of(from) || rank_of(to) == rank_of(from)
+                    ? pieces(ROOK, QUEEN) : pieces(BISHOP, QUEEN);
+
+  Bitboard b = line & sliders & occupied;
+
+  while (nonemptyBB(b))
+  {
+      Square s = pop_lsb(b);
+
+      // Behind 'from' as seen from 'to', with nothing in between
+      if (   nonemptyBB(between_bb(to, s) & from)
+          && !nonemptyBB(between_bb(from, s) & occupied & ~square_bb(s)))
+          return square_bb(s);
+  }
+
+  return NoSquares;
+}
+
+
+/// Position::see_ge (Static Exchange Evaluation Greater or Equal) tests if the
+/// SEE value of move is greater or equal to the given threshold. We'll use an
+/// algorithm similar to alpha-beta pruning with a null window. Pins are not
+/// taken into account.
+
+bool Position::see_ge(Move m, Value threshold) const {
+
+  assert(is_ok(m));
+
+  // Only deal with normal moves, assume others pass a simple SEE
+  if (type_of(m) != NORMAL)
+      return VALUE_ZERO >= threshold;
+
+  Square from = from_sq(m), to = to_sq(m);
+
+  int swap = PieceValue[MG][piece_on(to)] - threshold;
+  if (swap < 0)
+      return false;
+
+  swap = PieceValue[MG][piece_on(from)] - swap;
+  if (swap <= 0)
+      return true;
+
+  assert(color_of(piece_on(from)) == sideToMove);
+  Bitboard occupied = pieces() ^ from ^ to;
+  Color stm = sideToMove;
+  Bitboard attackers = attackers_to(to, occupied);
+  Bitboard stmAttackers, bb;
+  int res = 1;
+
+  while (true)
+  {
+      stm = ~stm;
+      attackers &= occupied;
+
+      // If stm has no more attackers then give up: stm loses
+      if (!nonemptyBB(stmAttackers = attackers & pieces(stm)))
+          break;
+
+      res ^= 1;
+
+      // Locate and remove the next least valuable attacker, and add to
+      // the bitboard 'attackers' any X-ray attacker behind it.
+      PieceType pt;
+      for (pt = PAWN; pt < KING; ++pt)
+          if (nonemptyBB(bb = stmAttackers & pieces(pt)))
+              break;
+
+      if (pt == KING)
+          // If we "capture" with the king but opponent still has attackers,
+          // reverse the result.
+          return nonemptyBB(attackers & ~pieces(stm)) ? res ^ 1 : res;
+
+      if ((swap = PieceValue[MG][pt] - swap) < res)
+          break;
+
+      Square s = lsb(bb);
+      occupied ^= s;
+      attackers |= xray(to, s, occupied);
+  }
+
+  return bool(res);
+}
+
+
+/// Position::see() computes the exact SEE value of a move given the attackers
+/// of its destination square, with a swap list resolved by negamax.
+
+Value Position::see(Move m, Bitboard attackers) const {
+
+  if (type_of(m) != NORMAL)
+      return VALUE_ZERO;
+
+  Square from = from_sq(m), to = to_sq(m);
+  Bitboard occupied = pieces() ^ from;
+  Color stm = color_of(piece_on(from));
+  PieceType captured = type_of(piece_on(from));
+  int gain[SQUARE_NB], d = 0;
+
+  gain[0] = PieceValue[MG][piece_on(to)];
+  attackers |= xray(to, from, occupied);
+
+  while (true)
+  {
+      stm = ~stm;
+      attackers &= occupied;
+
+      Bitboard stmAttackers = attackers & pieces(stm);
+      if (!nonemptyBB(stmAttackers))
+          break;
+
+      PieceType pt;
+      for (pt = PAWN; pt < KING; ++pt)
+          if (nonemptyBB(stmAttackers & pieces(pt)))
+              break;
+
+      // The king may not capture into a defended square
+      if (pt == KING && nonemptyBB(attackers & pieces(~stm)))
+          break;
+
+      ++d;
+      gain[d] = PieceValue[MG][captured] - gain[d - 1];
+
+      Square s = lsb(stmAttackers & pieces(pt));
+      occupied ^= s;
+      attackers |= xray(to, s, occupied);
+      captured = pt;
+  }
+
+  for ( ; d > 0; --d)
+      gain[d - 1] = -std::max(-gain[d - 1], gain[d]);
+
+  return Value(gain[0]);
+}
+
+
+/// Position::see() in batch mode scores a whole list of captures. Moves to
+/// the same square share one attackers_to() computation, which is where most
+/// of the cost lies on a 256 square board.
+
+void Position::see(const Move* moves, int n, Value* values) const {
+
+  Square targets[SQUARE_NB];
+  Bitboard attackers[SQUARE_NB];
+  int targetCnt = 0;
+
+  for (int i = 0; i < n; ++i)
+  {
+      Square to = to_sq(moves[i]);
+      int j = 0;
+
+      while (j < targetCnt && targets[j] != to)
+          ++j;
+
+      if (j == targetCnt)
+      {
+          targets[targetCnt] = to;
+          attackers[targetCnt++] = attackers_to(to);
+      }
+
+      values[i] = see(moves[i], attackers[j]);
+  }
+}
+
+
+/// Position::is_draw() tests whether the position is drawn by the 50-move
+/// rule or by repetition. A mate on the hundredth ply still counts. It does
+/// not detect stalemates.
+
+bool Position::is_draw(int ply) const {
+
+  if (st->rule50 > 99 && (!nonemptyBB(checkers()) || MoveList<LEGAL>(*this).size()))
+      return true;
+
+  // Return a draw score if a position repeats once earlier but strictly
+  // after the root, or repeats twice before or at the root.
+  return st->repetition && st->repetition < ply;
+}
+
+
+/// Position::has_game_cycle() tests if the position has a move which draws by
+/// repetition, or an earlier position has a move that directly reaches the
+/// current position. The keys of the earlier positions are probed in the
+/// cuckoo tables, one lookup each, instead of generating the moves.
+
+bool Position::has_game_cycle(int ply) const {
+
+  int j;
+
+  int end = std::min(st->rule50, st->pliesFromNull);
+
+  if (end < 3)
+    return false;
+
+  Key originalKey = st->key;
+  StateInfo* stp = st->previous;
+
+  for (int i = 3; i <= end; i += 2)
+  {
+      stp = stp->previous->previous;
+
+      Key moveKey = originalKey ^ stp->key;
+      if (   (j = H1(moveKey), cuckoo[j] == moveKey)
+          || (j = H2(moveKey), cuckoo[j] == moveKey))
+      {
+          Move move = cuckooMove[j];
+          Square s1 = from_sq(move);
+          Square s2 = to_sq(move);
+
+          // BetweenBB includes s2, which holds the piece when it moves back
+          if (!nonemptyBB((between_bb(s1, s2) ^ s2) & pieces()))
+          {
+              if (ply > i)
+                  return true;
+
+              // For nodes before or at the root, check that the move is a
+              // repetition rather than a move to the current position.
+              // In the cuckoo table, both moves Rc1c5 and Rc5c1 are stored in
+              // the same location, so we have to select which square to check.
+              if (color_of(piece_on(empty(s1) ? s2 : s1)) != side_to_move())
+                  continue;
+
+              // For repetitions before or at the root, require one more
+              if (stp->repetition)
+                  return true;
+          }
+      }
+  }
+  return false;
+}
+
+
+/// Position::pos_is_ok() performs some consistency checks for the
+/// position object and raises an asserts if something wrong is detected.
+/// This is meant to be helpful when debugging.
+
+bool Position::pos_is_ok() const {
+
+  constexpr bool Fast = true; // Quick (default) or full check?
+
+  if (   (sideToMove != WHITE && sideToMove != BLACK)
+      || (ep_square() != SQ_NONE && relative_rank(sideToMove, ep_square()) != RANK_14))
+      assert(0 && "pos_is_ok: Default");
+
+  if (Fast)
+      return true;
+
+  if (   pieceCount[W_KING] != 1
+      || pieceCount[B_KING] != 1)
+      assert(0 && "pos_is_ok: Kings");
+
+  if (   nonemptyBB(pieces(PAWN) & (Rank1BB | Rank16BB))
+      || pieceCount[W_PAWN] > 16
+      || pieceCount[B_PAWN] > 16)
+      assert(0 && "pos_is_ok: Pawns");
+
+  if (   nonemptyBB(pieces(WHITE) & pieces(BLACK))
+      || (pieces(WHITE) | pieces(BLACK)) != pieces()
+      || popcount(pieces(WHITE)) > 32
+      || popcount(pieces(BLACK)) > 32)
+      assert(0 && "pos_is_ok: Bitboards");
+
+  for (PieceType p1 = PAWN; p1 <= KING; ++p1)
+      for (PieceType p2 = PAWN; p2 <= KING; ++p2)
+          if (p1 != p2 && nonemptyBB(pieces(p1) & pieces(p2)))
+              assert(0 && "pos_is_ok: Bitboards");
+
+  for (Piece pc : { W_PAWN, W_KNIGHT, W_BISHOP, W_ROOK, W_QUEEN, W_KING,
+                    B_PAWN, B_KNIGHT, B_BISHOP, B_ROOK, B_QUEEN, B_KING })
+      if (pieceCount[pc] != popcount(pieces(color_of(pc), type_of(pc))))
+          assert(0 && "pos_is_ok: Pieces");
+
+  return true;
+}
+
+} // namespace Stockfish
@@ -0,0 +1,270 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2022 The Stockfish developers (see AUTHORS file)
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef POSITION_H_INCLUDED
+#define POSITION_H_INCLUDED
+
+#include <cassert>
+#include <string>
+
+#include "attackmap.h"
+#include "bitboard.h"
+#include "types.h"
+
+namespace Stockfish {
+
+/// StateInfo struct stores information needed to restore a Position object to
+/// its previous state when we retract a move. Whenever a move is made on the
+/// board (by calling Position::do_move), a StateInfo object must be passed.
+
+struct StateInfo {
+
+  // Copied when making a move
+  int    rule50;
+  int    pliesFromNull;
+  Square epSquare;
+
+  // Not copied when making a move (will be recomputed anyhow)
+  Key        key;
+  Piece      capturedPiece;
+  StateInfo* previous;
+  int        repetition;
+};
+
+
+/// Position class stores information regarding the board representation as
+/// pieces, side to move, en passant square and move counters. FEN strings
+/// use one field per rank like in chess, with empty-square counts up to 16.
+///
+/// Alongside the board the position keeps an AttackMap, which do_move() and
+/// undo_move() update incrementally.
+
+extern const char* StartFEN;
+
+class Position {
+public:
+  static void init();
+
+  Position() = default;
+  Position(const Position&) = default;
+  Position& operator=(const Position&) = default;
+
+  // FEN string input/output
+  static bool valid_fen(const std::string& fenStr);
+  Position& set(const std::string& fenStr, StateInfo* si);
+  std::string fen() const;
+
+  // Position representation
+  Bitboard pieces(PieceType pt = ALL_PIECES) const;
+  Bitboard pieces(PieceType pt1, PieceType pt2) const;
+  Bitboard pieces(Color c) const;
+  Bitboard pieces(Color c, PieceType pt) const;
+  Bitboard pieces(Color c, PieceType pt1, PieceType pt2) const;
+  Piece piece_on(Square s) const;
+  Square ep_square() const;
+  bool empty(Square s) const;
+  template<PieceType Pt> int count(Color c) const;
+  template<PieceType Pt> int count() const;
+  template<PieceType Pt> Square square(Color c) const;
+
+  // Attacks to/from a given square
+  Bitboard attackers_to(Square s) const;
+  Bitboard attackers_to(Square s, Bitboard occupied) const;
+  const AttackMap& attack_map() const;
+
+  // Properties of moves
+  bool legal(Move m) const;
+  bool pseudo_legal(const Move m) const;
+  bool capture(Move m) const;
+  bool capture_stage(Move m) const;
+  Piece moved_piece(Move m) const;
+  Piece captured_piece() const;
+
+  // Doing and undoing moves
+  void do_move(Move m, StateInfo& newSt);
+  void undo_move(Move m);
+
+  // Static Exchange Evaluation
+  bool see_ge(Move m, Value threshold = VALUE_ZERO) const;
+  void see(const Move* moves, int n, Value* values) const;
+
+  // Accessing hash keys
+  Key key() const;
+
+  // Other properties of the position
+  Color side_to_move() const;
+  int game_ply() const;
+  int rule50_count() const;
+  Bitboard checkers() const;
+  bool is_draw(int ply) const;
+  bool has_game_cycle(int ply) const;
+
+  // Position consistency check, for debugging
+  bool pos_is_ok() const;
+
+private:
+  // Initialization helpers (used while setting up a position)
+  void clear();
+  void set_state(StateInfo* si) const;
+
+  // Other helpers
+  void put_piece(Piece pc, Square s);
+  void remove_piece(Square s);
+  void move_piece(Square from, Square to);
+  Bitboard xray(Square to, Square from, Bitboard occupied) const;
+  Value see(Move m, Bitboard attackers) const;
+
+  // Data members
+  Piece board[SQUARE_NB];
+  Bitboard byTypeBB[PIECE_TYPE_NB];
+  Bitboard byColorBB[COLOR_NB];
+  int pieceCount[PIECE_NB];
+  int gamePly;
+  Color sideToMove;
+  StateInfo* st;
+  AttackMap attackMap;
+};
+
+std::ostream& operator<<(std::ostream& os, const Position& pos);
+
+inline Color Position::side_to_move() const {
+  return sideToMove;
+}
+
+inline Piece Position::piece_on(Square s) const {
+  assert(is_ok(s));
+  return board[s];
+}
+
+inline bool Position::empty(Square s) const {
+  return piece_on(s) == NO_PIECE;
+}
+
+inline Piece Position::moved_piece(Move m) const {
+  return piece_on(from_sq(m));
+}
+
+inline Bitboard Position::pieces(PieceType pt) const {
+  return byTypeBB[pt];
+}
+
+inline Bitboard Position::pieces(PieceType pt1, PieceType pt2) const {
+  return pieces(pt1) | pieces(pt2);
+}
+
+inline Bitboard Position::pieces(Color c) const {
+  return byColorBB[c];
+}
+
+inline Bitboard Position::pieces(Color c, PieceType pt) const {
+  return pieces(c) & pieces(pt);
+}
+
+inline Bitboard Position::pieces(Color c, PieceType pt1, PieceType pt2) const {
+  return pieces(c) & (pieces(pt1) | pieces(pt2));
+}
+
+template<PieceType Pt> inline int Position::count(Color c) const {
+  return pieceCount[make_piece(c, Pt)];
+}
+
+template<PieceType Pt> inline int Position::count() const {
+  return count<Pt>(WHITE) + count<Pt>(BLACK);
+}
+
+template<PieceType Pt> inline Square Position::square(Color c) const {
+  assert(count<Pt>(c) == 1);
+  return lsb(pieces(c, Pt));
+}
+
+inline Square Position::ep_square() const {
+  return st->epSquare;
+}
+
+inline Bitboard Position::attackers_to(Square s) const {
+  return attackers_to(s, pieces());
+}
+
+inline const AttackMap& Position::attack_map() const {
+  return attackMap;
+}
+
+inline bool Position::capture(Move m) const {
+  assert(is_ok(m));
+  return !empty(to_sq(m)) || type_of(m) == EN_PASSANT;
+}
+
+// Returns true if a move is generated from the capture stage, having also
+// queen promotions covered, i.e. consistency with the capture stage move
+// generation is needed to avoid the generation of duplicate moves.
+inline bool Position::capture_stage(Move m) const {
+  assert(is_ok(m));
+  return capture(m) || (type_of(m) == PROMOTION && promotion_type(m) == QUEEN);
+}
+
+inline Key Position::key() const {
+  return st->key;
+}
+
+inline int Position::game_ply() const {
+  return gamePly;
+}
+
+inline int Position::rule50_count() const {
+  return st->rule50;
+}
+
+inline Bitboard Position::checkers() const {
+  return attackers_to(square<KING>(sideToMove)) & pieces(~sideToMove);
+}
+
+inline Piece Position::captured_piece() const {
+  return st->capturedPiece;
+}
+
+inline void Position::put_piece(Piece pc, Square s) {
+
+  board[s] = pc;
+  byTypeBB[ALL_PIECES] |= byTypeBB[type_of(pc)] |= s;
+  byColorBB[color_of(pc)] |= s;
+  pieceCount[pc]++;
+  pieceCount[make_piece(color_of(pc), ALL_PIECES)]++;
+}
+
+inline void Position::remove_piece(Square s) {
+
+  Piece pc = board[s];
+  byTypeBB[ALL_PIECES] ^= s;
+  byTypeBB[type_of(pc)] ^= s;
+  byColorBB[color_of(pc)] ^= s;
+  board[s] = NO_PIECE;
+  pieceCount[pc]--;
+  pieceCount[make_piece(color_of(pc), ALL_PIECES)]--;
+}
+
+inline void Position::move_piece(Square from, Square to) {
+
+  Piece pc = board[from];
+  Bitboard fromTo = from | to;
+  byTypeBB[ALL_PIECES] ^= fromTo;
+  byTypeBB[type_of(pc)] ^= fromTo;
+  byColorBB[color_of(pc)] ^= fromTo;
+  board[from] = NO_PIECE;
+  board[to] = pc;
+}
+
+} // namespace Stockfish
+
+#endif // #ifndef POSITION_H_INCLUDED
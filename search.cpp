@@ -0,0 +1,482 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2022 The Stockfish developers (see AUTHORS file)
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <algorithm>
+#include <cstring>   // For std::memset
+#include <memory>
+
+#include "evaluate.h"
+#include "movegen.h"
+#include "movepick.h"
+#include "position.h"
+#include "search.h"
+#include "tablebase.h"
+#include "tt.h"
+
+namespace Stockfish {
+
+namespace Search {
+
+namespace {
+
+  // Different node types, used as a template parameter
+  enum NodeType { NonPV, PV, Root };
+
+  // Time is checked every this many nodes, node limits are exact
+  constexpr uint64_t TimeCheckInterval = 1024;
+
+  // History and stats update bonus, based on depth
+  int stat_bonus(Depth d) {
+    return std::min(32 * d * d, 1500);
+  }
+
+  Value value_to_tt(Value v, int ply);
+  Value value_from_tt(Value v, int ply);
+  void update_pv(Move* pv, Move move, const Move* childPv);
+
+  // Worker holds the state of one search. Workers of concurrent searches
+  // only share the transposition table.
+  class Worker {
+  public:
+    Worker(Position& p, const LimitsType& l, const std::atomic<bool>& s)
+      : pos(p), limits(l), stop(s), startTime(now()) {}
+
+    Result iterative_deepening();
+
+  private:
+    template<NodeType nodeType>
+    Value search(Stack* ss, Value alpha, Value beta, Depth depth);
+
+    template<NodeType nodeType>
+    Value qsearch(Stack* ss, Value alpha, Value beta);
+
+    void update_quiet_stats(Stack* ss, Move move, Depth depth, const Move* quiets, int quietCount);
+    bool out_of_resources();
+
+    Position& pos;
+    const LimitsType& limits;
+    const std::atomic<bool>& stop;
+    TimePoint startTime;
+    uint64_t nodes = 0;
+    bool aborted = false;
+    uint64_t cutoffs[PICK_STAGE_NB] = {};
+    ButterflyHistory mainHistory = {};
+    CounterMoves counterMoves = {};
+  };
+
+
+  // Worker::out_of_resources() is called once per node and tells whether
+  // the search must stop. Node limits are checked exactly, so that searches
+  // with a node limit are reproducible.
+  bool Worker::out_of_resources() {
+
+    if (aborted)
+        return true;
+
+    if (   (limits.nodes && nodes >= limits.nodes)
+        || (   nodes % TimeCheckInterval == 0
+            && (   stop.load(std::memory_order_relaxed)
+                || (limits.movetime && now() - startTime >= limits.movetime))))
+        aborted = true;
+
+    return aborted;
+  }
+
+
+  // Worker::update_quiet_stats() updates the move sorting heuristics when a
+  // quiet move causes a beta cutoff: killers, countermove and the history,
+  // which also penalizes the quiet moves searched before it.
+  void Worker::update_quiet_stats(Stack* ss, Move move, Depth depth, const Move* quiets, int quietCount) {
+
+    // Update killers
+    if (ss->killers[0] != move)
+    {
+        ss->killers[1] = ss->killers[0];
+        ss->killers[0] = move;
+    }
+
+    Color us = pos.side_to_move();
+    int bonus = stat_bonus(depth);
+
+    mainHistory.update(us, move, bonus);
+    for (int i = 0; i < quietCount; ++i)
+        mainHistory.update(us, quiets[i], -bonus);
+
+    // Update countermove
+    if (is_ok((ss-1)->currentMove))
+    {
+        Square prevSq = to_sq((ss-1)->currentMove);
+        counterMoves[pos.piece_on(prevSq)][prevSq] = move;
+    }
+  }
+
+
+  // Worker::iterative_deepening() calls search() repeatedly with increasing
+  // depth until a limit is reached, and returns the result of the last
+  // completed iteration.
+  Result Worker::iterative_deepening() {
+
+    Stack stack[MAX_PLY + 5], *ss = stack + 2; // To reference from (ss-2) to (ss+2)
+    Move pv[MAX_PLY + 1];
+    Result result;
+
+    std::memset(stack, 0, sizeof(stack));
+    for (int i = 0; i <= MAX_PLY + 4; ++i)
+        stack[i].ply = i - 2;
+
+    ss->pv = pv;
+    pv[0] = MOVE_NONE;
+
+    const Depth maxDepth = limits.depth ? std::min(limits.depth, MAX_PLY - 1) : MAX_PLY - 1;
+
+    for (Depth depth = 1; depth <= maxDepth; ++depth)
+    {
+        Value value = search<Root>(ss, -VALUE_INFINITE, VALUE_INFINITE, depth);
+
+        // An interrupted iteration is only used when there is nothing else,
+        // its best move being searched first it is at least as good.
+        if (aborted && result.bestMove != MOVE_NONE)
+            break;
+
+        result.bestMove = pv[0];
+        result.score = value;
+        result.depth = depth;
+        result.pv.clear();
+        for (Move* m = pv; *m != MOVE_NONE; ++m)
+            result.pv.push_back(*m);
+
+        if (aborted || result.bestMove == MOVE_NONE || abs(value) >= VALUE_MATE_IN_MAX_PLY)
+            break;
+    }
+
+    // Stopped before the first move of the first iteration was searched
+    if (result.bestMove == MOVE_NONE && MoveList<LEGAL>(pos).size())
+    {
+        result.bestMove = *MoveList<LEGAL>(pos).begin();
+        result.score = Eval::evaluate(pos);
+        result.depth = 0;
+        result.pv = { result.bestMove };
+    }
+
+    result.nodes = nodes;
+    std::copy(std::begin(cutoffs), std::end(cutoffs), result.cutoffs);
+    result.elapsed = now() - startTime;
+    return result;
+  }
+
+
+  // Worker::search() is the main alpha-beta search, principal variation
+  // nodes are searched with a full window, the others with a null window.
+  template<NodeType nodeType>
+  Value Worker::search(Stack* ss, Value alpha, Value beta, Depth depth) {
+
+    constexpr bool PvNode   = nodeType != NonPV;
+    constexpr bool rootNode = nodeType == Root;
+
+    // Check if we have an upcoming move which draws by repetition, or
+    // if the opponent had an alternative move earlier to this position.
+    if (   !rootNode
+        && pos.rule50_count() >= 3
+        && alpha < VALUE_DRAW
+        && pos.has_game_cycle(ss->ply))
+    {
+        alpha = VALUE_DRAW;
+        if (alpha >= beta)
+            return alpha;
+    }
+
+    if (depth <= 0)
+        return qsearch<PvNode ? PV : NonPV>(ss, alpha, beta);
+
+    assert(-VALUE_INFINITE <= alpha && alpha < beta && beta <= VALUE_INFINITE);
+    assert(PvNode || (alpha == beta - 1));
+
+    Move pv[MAX_PLY + 1];
+    StateInfo st;
+
+    ++nodes;
+    if (out_of_resources())
+        return VALUE_ZERO;
+
+    if (!rootNode)
+    {
+        if (pos.is_draw(ss->ply) || ss->ply >= MAX_PLY)
+            return ss->ply >= MAX_PLY ? Eval::evaluate(pos) : VALUE_DRAW;
+
+        // Mate distance pruning. Even if we mate at the next move our score
+        // would be at best mate_in(ss->ply+1), but if alpha is already bigger
+        // because a shorter mate was found upward in the tree then there is
+        // no need to search because we will never beat the current alpha.
+        alpha = std::max(mated_in(ss->ply), alpha);
+        beta = std::min(mate_in(ss->ply+1), beta);
+        if (alpha >= beta)
+            return alpha;
+
+        // Endgame tablebases. A won position scores below the mates, less
+        // the further the next capture or the mate, so that the search makes
+        // progress towards it.
+        if (popcount(pos.pieces()) <= Tablebases::MaxCardinality)
+        {
+            Tablebases::ProbeState err;
+            Tablebases::WDLScore wdl = Tablebases::probe_wdl(pos, &err);
+
+            if (err != Tablebases::FAIL)
+            {
+                if (wdl == Tablebases::WDLDraw)
+                    return VALUE_DRAW;
+
+                int dtz = std::min(std::abs(Tablebases::probe_dtz(pos, &err)), MAX_PLY - 1 - ss->ply);
+                Value v = VALUE_MATE_IN_MAX_PLY - 1 - ss->ply - dtz;
+                return wdl == Tablebases::WDLWin ? v : -v;
+            }
+        }
+    }
+
+    // Transposition table lookup
+    bool ttHit;
+    const Key posKey = pos.key();
+    TTEntry* tte = TT.probe(posKey, ttHit);
+    const Value ttValue = ttHit ? value_from_tt(tte->value(), ss->ply) : VALUE_NONE;
+    const Move ttMove = rootNode ? ss->pv[0] : ttHit ? tte->move() : MOVE_NONE;
+
+    // At non-PV nodes we check for an early TT cutoff
+    if (  !PvNode
+        && ttHit
+        && tte->depth() >= depth
+        && ttValue != VALUE_NONE // Possible in case of TT access race
+        && (tte->bound() & (ttValue >= beta ? BOUND_LOWER : BOUND_UPPER)))
+        return ttValue;
+
+    const bool inCheck = nonemptyBB(pos.checkers());
+    ss->staticEval = inCheck ? VALUE_NONE : ttHit && tte->eval() != VALUE_NONE ? tte->eval() : Eval::evaluate(pos);
+
+    (ss+2)->killers[0] = (ss+2)->killers[1] = MOVE_NONE;
+
+    const Square prevSq = is_ok((ss-1)->currentMove) ? to_sq((ss-1)->currentMove) : SQ_NONE;
+    const Move countermove = prevSq != SQ_NONE ? counterMoves[pos.piece_on(prevSq)][prevSq] : MOVE_NONE;
+
+    MovePicker mp(pos, ttMove, depth, &mainHistory, ss->killers, countermove);
+
+    Value bestValue = -VALUE_INFINITE;
+    Move bestMove = MOVE_NONE, move;
+    Move quietsSearched[64];
+    int moveCount = 0, quietCount = 0;
+
+    if (PvNode)
+        ss->pv[0] = MOVE_NONE;
+
+    // Loop through the moves until no moves remain or a beta cutoff occurs
+    while ((move = mp.next_move()) != MOVE_NONE)
+    {
+        Value value;
+
+        if (!pos.legal(move))
+            continue;
+
+        ss->currentMove = move;
+        ++moveCount;
+
+        pos.do_move(move, st);
+
+        // Principal variation search: the first move with a full window,
+        // the others with a null window and a re-search if they fail high.
+        if (!PvNode || moveCount > 1)
+            value = -search<NonPV>(ss+1, -(alpha+1), -alpha, depth - 1);
+
+        if (PvNode && (moveCount == 1 || (value > alpha && (rootNode || value < beta))))
+        {
+            (ss+1)->pv = pv;
+            (ss+1)->pv[0] = MOVE_NONE;
+
+            value = -search<PV>(ss+1, -beta, -alpha, depth - 1);
+        }
+
+        pos.undo_move(move);
+
+        if (aborted)
+            return VALUE_ZERO;
+
+        if (value > bestValue)
+        {
+            bestValue = value;
+
+            if (value > alpha)
+            {
+                bestMove = move;
+
+                if (PvNode) // Update pv even in fail-high case
+                    update_pv(ss->pv, move, (ss+1)->pv);
+
+                if (PvNode && value < beta) // Update alpha! Always alpha < beta
+                    alpha = value;
+                else
+                {
+                    assert(value >= beta); // Fail high
+                    ++cutoffs[mp.picked()];
+                    break;
+                }
+            }
+        }
+
+        if (move != bestMove && !pos.capture_stage(move) && quietCount < 64)
+            quietsSearched[quietCount++] = move;
+    }
+
+    // No legal move: checkmate or stalemate
+    if (!moveCount)
+        bestValue = inCheck ? mated_in(ss->ply) : VALUE_DRAW;
+
+    // A quiet move that caused a cutoff updates the ordering heuristics
+    else if (bestValue >= beta && !pos.capture_stage(bestMove))
+        update_quiet_stats(ss, bestMove, depth, quietsSearched, quietCount);
+
+    tte->save(posKey, value_to_tt(bestValue, ss->ply), PvNode,
+              bestValue >= beta ? BOUND_LOWER :
+              PvNode && bestMove ? BOUND_EXACT : BOUND_UPPER,
+              depth, bestMove, ss->staticEval);
+
+    return bestValue;
+  }
+
+
+  // Worker::qsearch() searches the captures that do not lose material, or
+  // every move when in check, until the position is quiet.
+  template<NodeType nodeType>
+  Value Worker::qsearch(Stack* ss, Value alpha, Value beta) {
+
+    constexpr bool PvNode = nodeType == PV;
+
+    assert(alpha >= -VALUE_INFINITE && alpha < beta && beta <= VALUE_INFINITE);
+    assert(PvNode || (alpha == beta - 1));
+
+    StateInfo st;
+
+    ++nodes;
+    if (out_of_resources())
+        return VALUE_ZERO;
+
+    if (pos.is_draw(ss->ply) || ss->ply >= MAX_PLY)
+        return ss->ply >= MAX_PLY ? Eval::evaluate(pos) : VALUE_DRAW;
+
+    const bool inCheck = nonemptyBB(pos.checkers());
+    Value bestValue;
+
+    if (inCheck)
+        bestValue = -VALUE_INFINITE;
+    else
+    {
+        // Stand pat. Return immediately if static value is at least beta
+        bestValue = ss->staticEval = Eval::evaluate(pos);
+
+        if (bestValue >= beta)
+            return bestValue;
+
+        if (PvNode && bestValue > alpha)
+            alpha = bestValue;
+    }
+
+    // The captures, or every move when in check
+    MovePicker mp(pos, &mainHistory);
+    Move move;
+    int moveCount = 0;
+
+    while ((move = mp.next_move()) != MOVE_NONE)
+    {
+        if (!pos.legal(move))
+            continue;
+
+        ++moveCount;
+
+        // Do not search moves with negative SEE values
+        if (!inCheck && !pos.see_ge(move))
+            continue;
+
+        ss->currentMove = move;
+        pos.do_move(move, st);
+        Value value = -qsearch<nodeType>(ss+1, -beta, -alpha);
+        pos.undo_move(move);
+
+        if (aborted)
+            return VALUE_ZERO;
+
+        if (value > bestValue)
+        {
+            bestValue = value;
+
+            if (value > alpha)
+            {
+                if (PvNode && value < beta) // Update alpha here!
+                    alpha = value;
+                else
+                    break; // Fail high
+            }
+        }
+    }
+
+    // All legal moves have been searched. A special case: if we're in check
+    // and no legal moves were found, it is checkmate.
+    if (inCheck && !moveCount)
+        return mated_in(ss->ply); // Plies to mate from the root
+
+    return bestValue;
+  }
+
+
+  // value_to_tt() adjusts a mate or TB score from "plies to mate from the root"
+  // to "plies to mate from the current position". Standard scores are unchanged.
+  // The function is called before storing a value in the transposition table.
+  Value value_to_tt(Value v, int ply) {
+
+    assert(v != VALUE_NONE);
+
+    return  v >= VALUE_TB_WIN_IN_MAX_PLY  ? v + ply
+          : v <= VALUE_TB_LOSS_IN_MAX_PLY ? v - ply : v;
+  }
+
+
+  // value_from_tt() is the inverse of value_to_tt(): it adjusts a mate score
+  // from the transposition table (which refers to the plies to mate from the
+  // position) to "plies to mate from the current position".
+  Value value_from_tt(Value v, int ply) {
+
+    if (v == VALUE_NONE)
+        return VALUE_NONE;
+
+    return  v >= VALUE_TB_WIN_IN_MAX_PLY  ? v - ply
+          : v <= VALUE_TB_LOSS_IN_MAX_PLY ? v + ply : v;
+  }
+
+
+  // update_pv() adds current move and appends child pv[]
+  void update_pv(Move* pv, Move move, const Move* childPv) {
+
+    for (*pv++ = move; childPv && *childPv != MOVE_NONE; )
+        *pv++ = *childPv++;
+    *pv = MOVE_NONE;
+  }
+
+} // namespace
+
+
+Result search(Position& pos, const LimitsType& limits, const std::atomic<bool>& stop) {
+
+  // The histories take a few hundred KB, too much for the stack of a worker
+  return std::make_unique<Worker>(pos, limits, stop)->iterative_deepening();
+}
+
+} // namespace Search
+
+} // namespace Stockfish
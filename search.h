@@ -0,0 +1,87 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2022 The Stockfish developers (see AUTHORS file)
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef SEARCH_H_INCLUDED
+#define SEARCH_H_INCLUDED
+
+#include <atomic>
+#include <vector>
+
+#include "misc.h"
+#include "movepick.h"
+#include "types.h"
+
+namespace Stockfish {
+
+class Position;
+
+namespace Search {
+
+/// Stack struct keeps track of the information we need to remember from nodes
+/// shallower and deeper in the tree during the search. Each search thread has
+/// its own array of Stack objects, indexed by the current ply.
+
+struct Stack {
+  Move* pv;
+  int ply;
+  Move currentMove;
+  Value staticEval;
+  Move killers[2];
+};
+
+
+/// LimitsType struct stores the resources a search may use. A zero field
+/// means no limit on that resource.
+
+struct LimitsType {
+
+  LimitsType() {
+    depth = 0;
+    nodes = 0;
+    movetime = 0;
+  }
+
+  Depth depth;
+  uint64_t nodes;
+  TimePoint movetime;
+};
+
+
+/// Result of a search: the best move and score of the last completed
+/// iteration, and the resources used. cutoffs[] counts the beta cutoffs of
+/// the main search by the MovePicker stage of the move that caused them.
+
+struct Result {
+  Move bestMove = MOVE_NONE;
+  Value score = -VALUE_INFINITE;
+  Depth depth = 0;
+  uint64_t nodes = 0;
+  TimePoint elapsed = 0;
+  std::vector<Move> pv;
+  uint64_t cutoffs[PICK_STAGE_NB] = {};
+};
+
+/// search() searches the given position until a limit is reached or stop is
+/// set. Any number of searches may run at once from different threads, they
+/// share the transposition table TT and nothing else.
+
+Result search(Position& pos, const LimitsType& limits, const std::atomic<bool>& stop);
+
+} // namespace Search
+
+} // namespace Stockfish
+
+#endif // #ifndef SEARCH_H_INCLUDED
@@ -0,0 +1,393 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2022 The Stockfish developers (see AUTHORS file)
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "position.h"
+#include "search.h"
+#include "server.h"
+#include "thread.h"
+#include "tt.h"
+#include "uci.h"
+
+using std::string;
+
+namespace Stockfish {
+
+namespace {
+
+  ThreadPool Pool;
+
+  // TableGate lets the searches of all the clients share the hash table,
+  // while an operation on the whole table (clear, aging, save, merge) waits
+  // for the running searches to end and holds back new ones until it is done.
+  // A waiting operation goes before new searches, so it cannot starve.
+  class TableGate {
+  public:
+    void enter_search() {
+      std::unique_lock<std::mutex> lk(mutex);
+      cv.wait(lk, [&]{ return !exclusive; });
+      ++searches;
+    }
+
+    void leave_search() {
+      std::lock_guard<std::mutex> lk(mutex);
+      if (--searches == 0)
+          cv.notify_all();
+    }
+
+    template<typename F>
+    void exclusive_run(F f) {
+      std::unique_lock<std::mutex> lk(mutex);
+      cv.wait(lk, [&]{ return !exclusive; });
+      exclusive = true;
+      cv.wait(lk, [&]{ return searches == 0; });
+      lk.unlock();
+
+      f();
+
+      lk.lock();
+      exclusive = false;
+      cv.notify_all();
+    }
+
+  private:
+    std::mutex mutex;
+    std::condition_variable cv;
+    size_t searches = 0;
+    bool exclusive = false;
+  };
+
+  TableGate Gate;
+
+  // Client is one session. Results are written under a lock, by whichever
+  // worker finishes, and the client tracks its outstanding searches for
+  // isready and stop.
+  class Client {
+  public:
+    explicit Client(std::ostream& o) : os(&o) {}
+    explicit Client(int f) : fd(f) {}
+   ~Client() {
+#ifdef __linux__
+      if (fd >= 0)
+          close(fd);
+#endif
+    }
+
+    void send(const string& line) {
+      std::lock_guard<std::mutex> lk(writeMutex);
+      if (os)
+          *os << line << std::endl;
+#ifdef __linux__
+      else
+      {
+          const string msg = line + "\n";
+          for (size_t done = 0; done < msg.size(); )
+          {
+              ssize_t n = ::send(fd, msg.data() + done, msg.size() - done, MSG_NOSIGNAL);
+              if (n <= 0)
+                  break; // Client is gone, drop the rest
+              done += size_t(n);
+          }
+      }
+#endif
+    }
+
+    // Each search has its own stop flag, so that stop only ends the searches
+    // queued before it and never one submitted after it.
+    using StopFlag = std::shared_ptr<std::atomic<bool>>;
+
+    StopFlag job_started() {
+      std::lock_guard<std::mutex> lk(jobMutex);
+      running.push_back(std::make_shared<std::atomic<bool>>(false));
+      return running.back();
+    }
+
+    void job_done(const StopFlag& flag) {
+      std::lock_guard<std::mutex> lk(jobMutex);
+      running.erase(std::find(running.begin(), running.end(), flag));
+      if (running.empty())
+          jobsDone.notify_all();
+    }
+
+    void stop_jobs() {
+      std::lock_guard<std::mutex> lk(jobMutex);
+      for (const StopFlag& flag : running)
+          *flag = true;
+    }
+
+    void wait_for_jobs() {
+      std::unique_lock<std::mutex> lk(jobMutex);
+      jobsDone.wait(lk, [&]{ return running.empty(); });
+    }
+
+  private:
+    std::ostream* os = nullptr;
+    int fd = -1;
+    std::mutex writeMutex, jobMutex;
+    std::condition_variable jobsDone;
+    std::vector<StopFlag> running;
+  };
+
+  // Request is a queued search, parsed by the worker that runs it so that
+  // the reader only splits lines.
+  struct Request {
+    string id;
+    Search::LimitsType limits;
+    string fen;
+    std::vector<string> moves;
+  };
+
+  void analyse(Client& client, const Request& req, const std::atomic<bool>& stop) {
+
+    std::deque<StateInfo> states(1);
+    Position pos;
+
+    if (!Position::valid_fen(req.fen))
+        return client.send("error id " + req.id + " invalid fen");
+
+    pos.set(req.fen, &states.back());
+
+    // The king of the side not to move must not be capturable
+    Color them = ~pos.side_to_move();
+    if (nonemptyBB(pos.attackers_to(pos.square<KING>(them)) & pos.pieces(~them)))
+        return client.send("error id " + req.id + " side not to move is in check");
+
+    for (string token : req.moves)
+    {
+        Move m = UCI::to_move(pos, token);
+        if (m == MOVE_NONE)
+            return client.send("error id " + req.id + " illegal move " + token);
+
+        states.emplace_back();
+        pos.do_move(m, states.back());
+    }
+
+    Search::Result r = Search::search(pos, req.limits, stop);
+
+    std::ostringstream ss;
+    ss << "result id " << req.id
+       << " bestmove " << UCI::move(r.bestMove)
+       << " score "    << (r.bestMove ? UCI::value(r.score) : "none")
+       << " depth "    << r.depth
+       << " nodes "    << r.nodes
+       << " time "     << r.elapsed
+       << " pv";
+
+    for (Move m : r.pv)
+        ss << " " << UCI::move(m);
+
+    client.send(ss.str());
+  }
+
+  // go() parses a search request and queues it, blocking while the queue
+  // of the pool is full.
+  void go(const std::shared_ptr<Client>& client, std::istringstream& is) {
+
+    Request req;
+    string token;
+
+    while (is >> token)
+        if (token == "id")
+            is >> req.id;
+        else if (token == "depth")
+            is >> req.limits.depth;
+        else if (token == "nodes")
+            is >> req.limits.nodes;
+        else if (token == "movetime")
+            is >> req.limits.movetime;
+        else if (token == "startpos")
+            req.fen = StartFEN;
+        else if (token == "fen")
+            while (is >> token && token != "moves")
+                req.fen += token + " ";
+        else if (token != "moves") // Any other token is a move
+            req.moves.push_back(token);
+
+    if (req.id.empty())
+        return client->send("error id - missing id");
+
+    if (!req.limits.depth && !req.limits.nodes && !req.limits.movetime)
+        return client->send("error id " + req.id + " no depth, nodes or movetime limit");
+
+    Client::StopFlag stop = client->job_started();
+    Pool.submit([client, req, stop]() {
+        Gate.enter_search();
+        analyse(*client, req, *stop);
+        Gate.leave_search();
+        client->job_done(stop);
+    });
+  }
+
+  // session() reads the requests of a client until quit or end of input.
+  // At end of input the outstanding searches are completed, quit ends them.
+  template<typename ReadLine>
+  void session(const std::shared_ptr<Client>& client, ReadLine read_line) {
+
+    string cmd, token, path;
+
+    while (read_line(cmd))
+    {
+        std::istringstream is(cmd);
+
+        token.clear(); // Avoid a stale if getline() returns nothing or a blank line
+        is >> std::skipws >> token;
+
+        if (token == "quit")
+        {
+            client->stop_jobs();
+            break;
+        }
+        else if (token == "go")
+            go(client, is);
+        else if (token == "isready")
+        {
+            client->wait_for_jobs();
+            Gate.exclusive_run([]{ TT.new_search(); });
+            client->send("readyok");
+        }
+        else if (token == "stop")
+            client->stop_jobs();
+        else if (token == "clear")
+        {
+            client->wait_for_jobs();
+            Gate.exclusive_run([]{ TT.clear(); });
+        }
+        else if ((token == "save" || token == "merge") && is >> path)
+        {
+            client->wait_for_jobs();
+
+            bool ok;
+            Gate.exclusive_run([&]{ ok = token == "save" ? TT.save(path) : TT.merge(path); });
+
+            if (ok)
+                client->send((token == "save" ? "saved " : "merged ") + path);
+            else
+                client->send("error id - cannot " + token + " " + path);
+        }
+        else if (!token.empty())
+            client->send("error id - unknown command " + token);
+    }
+
+    client->wait_for_jobs();
+  }
+
+#ifdef __linux__
+  // serve_socket() accepts clients on a Unix socket, each one read by its
+  // own thread, until the process is killed.
+  void serve_socket(const string& path) {
+
+    int server = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+
+    if (server < 0 || path.size() >= sizeof(addr.sun_path))
+    {
+        std::cerr << "Cannot create socket " << path << std::endl;
+        return;
+    }
+
+    path.copy(addr.sun_path, path.size());
+    unlink(path.c_str());
+
+    if (   bind(server, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0
+        || listen(server, 16) < 0)
+    {
+        std::cerr << "Cannot listen on " << path << std::endl;
+        close(server);
+        return;
+    }
+
+    std::cout << "info string listening on " << path << std::endl;
+
+    while (true)
+    {
+        int fd = accept(server, nullptr, nullptr);
+        if (fd < 0)
+            continue;
+
+        std::thread([fd]() {
+
+            auto client = std::make_shared<Client>(fd);
+            FILE* in = fdopen(dup(fd), "r");
+            char* buf = nullptr;
+            size_t cap = 0;
+
+            session(client, [&](string& line) {
+                ssize_t n = in ? getline(&buf, &cap, in) : -1;
+                if (n < 0)
+                    return false;
+                line.assign(buf, size_t(n));
+                return true;
+            });
+
+            free(buf);
+            if (in)
+                fclose(in);
+        }).detach();
+    }
+  }
+#endif
+
+} // namespace
+
+
+/// Server::run() sets up the shared pool and hash table, then serves the
+/// clients until stdin is closed or, with a socket, forever.
+
+void Server::run(const Options& options) {
+
+  if (options.hashFile.empty() || !TT.load(options.hashFile, false))
+      TT.resize(options.hashMb);
+  else
+      std::cout << "info string hash table mapped from " << options.hashFile << std::endl;
+
+  Pool.set(options.threads, options.queue);
+
+  if (options.socketPath.empty())
+      session(std::make_shared<Client>(std::cout), [](string& line) {
+          return bool(std::getline(std::cin, line));
+      });
+  else
+  {
+#ifdef __linux__
+      serve_socket(options.socketPath);
+#else
+      std::cerr << "Unix sockets are not supported on this platform" << std::endl;
+#endif
+  }
+
+  Pool.set(0, 0);
+}
+
+} // namespace Stockfish
@@ -0,0 +1,69 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2022 The Stockfish developers (see AUTHORS file)
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef SERVER_H_INCLUDED
+#define SERVER_H_INCLUDED
+
+#include <cstddef>
+#include <string>
+
+namespace Stockfish {
+
+/// Server namespace implements the long-lived analysis mode. Clients send
+/// one request per line, either on stdin or on a Unix socket:
+///
+///   go id <id> [depth <d>] [nodes <n>] [movetime <ms>]
+///      (startpos | fen <fen>) [moves <move> ...]
+///                 queues a search, answered later by one line
+///                 "result id <id> bestmove <m> score <s> depth <d> nodes <n>
+///                  time <ms> pv <moves>" or "error id <id> <reason>"
+///   isready       answered by "readyok" once all the client's searches
+///                 have been answered, and ages the hash table
+///   stop          ends the client's outstanding searches early
+///   clear         waits for the client's searches then empties the hash
+///                 table
+///   save <file>   waits for the client's searches then writes the hash
+///                 table to a snapshot file, answered by "saved <file>"
+///   merge <file>  adds the entries of a snapshot file of a table of the
+///                 same size to the hash table, answered by "merged <file>"
+///   quit          stops the client's searches and closes the session
+///
+/// Searches from every client run on one worker pool and share one hash
+/// table. Aging, clearing, saving or merging the table waits for the running
+/// searches of all the clients, and searches started meanwhile wait for it.
+/// Results are written as soon as a search ends, so they may come in any
+/// order; the id ties them to the requests. The pool accepts a bounded number
+/// of waiting searches, beyond which the server stops reading requests until
+/// a worker is free. With a hash file the table is mapped from a snapshot at
+/// start, so that a restart keeps a warm table.
+
+namespace Server {
+
+struct Options {
+  size_t threads;
+  size_t hashMb;
+  size_t queue;
+  std::string socketPath; // Empty for stdin/stdout
+  std::string hashFile;   // Snapshot to start from, empty for an empty table
+};
+
+void run(const Options& options);
+
+} // namespace Server
+
+} // namespace Stockfish
+
+#endif // #ifndef SERVER_H_INCLUDED
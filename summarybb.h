@@ -0,0 +1,119 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2022 The Stockfish developers (see AUTHORS file)
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef SUMMARYBB_H_INCLUDED
+#define SUMMARYBB_H_INCLUDED
+
+#include "bitboard.h"
+
+namespace Stockfish {
+
+/// SummaryBitboard is a Bitboard tagged with the summary of its words: bit i
+/// of mask is set if and only if word b[i] is non-zero. Most sets of a real
+/// position (a king, the queens, the pawns of one side) live in one or two
+/// of the four words, and the scans below visit only those: lsb() and msb()
+/// find their word with a single tzcnt/lzcnt on the mask instead of testing
+/// the words in turn, popcount() only counts the non-zero words and
+/// more_than_one() is decided on the mask alone as soon as two words are set.
+///
+/// The mask is kept exact by every operation, so that empty() and the scans
+/// never look at a zero word. The binary operators still combine all four
+/// words, branch-free, which costs less than dispatching on the masks, and
+/// rebuild the mask from the result except for operator|, where it is the
+/// union of the masks. It is an optional type: the engine keeps the plain
+/// Bitboard, and microbench compares the two on the piece sets of a game.
+
+struct SummaryBitboard {
+
+  static_assert(SQUARE_NB == 256, "The summary mask has one bit for each of four 64-bit words");
+
+  Bitboard bb;
+  unsigned mask;
+
+  static constexpr unsigned summary(const Bitboard& b) {
+    return  unsigned(b.b[0] != 0)       | unsigned(b.b[1] != 0) << 1
+          | unsigned(b.b[2] != 0) << 2  | unsigned(b.b[3] != 0) << 3;
+  }
+
+  SummaryBitboard() = default;
+  constexpr SummaryBitboard(Bitboard b) : bb(b), mask(summary(b)) {}
+  constexpr SummaryBitboard(Bitboard b, unsigned m) : bb(b), mask(m) {}
+
+  constexpr operator Bitboard() const { return bb; }
+
+  constexpr bool empty() const { return !mask; }
+
+  /// limbs() is the number of non-zero words
+
+  int limbs() const { return __builtin_popcount(mask); }
+
+  SummaryBitboard& operator|=(SummaryBitboard x) { return *this = *this | x; }
+  SummaryBitboard& operator&=(SummaryBitboard x) { return *this = *this & x; }
+  SummaryBitboard& operator^=(SummaryBitboard x) { return *this = *this ^ x; }
+
+  friend SummaryBitboard operator|(SummaryBitboard x, SummaryBitboard y) { return { x.bb | y.bb, x.mask | y.mask }; }
+  friend SummaryBitboard operator&(SummaryBitboard x, SummaryBitboard y) { return SummaryBitboard(x.bb & y.bb); }
+  friend SummaryBitboard operator^(SummaryBitboard x, SummaryBitboard y) { return SummaryBitboard(x.bb ^ y.bb); }
+  friend SummaryBitboard operator~(SummaryBitboard x) { return SummaryBitboard(~x.bb); }
+
+  friend bool operator==(SummaryBitboard x, SummaryBitboard y) { return x.mask == y.mask && x.bb == y.bb; }
+  friend bool operator!=(SummaryBitboard x, SummaryBitboard y) { return !(x == y); }
+};
+
+/// Same names as the Bitboard versions in bitboard.h, dispatching on the mask
+
+inline int popcount(SummaryBitboard b) {
+#if defined(__POPCNT__)
+  // With a hardware popcnt, counting all the words beats the loop on the mask
+  return popcount(b.bb);
+#else
+  int n = 0;
+  for (unsigned m = b.mask; m; m &= m - 1)
+      n += __builtin_popcountll(b.bb.b[__builtin_ctz(m)]);
+  return n;
+#endif
+}
+
+inline bool more_than_one(SummaryBitboard b) {
+  if (b.mask & (b.mask - 1))
+      return true;
+  return b.mask && more_than_one_b64(b.bb.b[__builtin_ctz(b.mask)]);
+}
+
+inline Square lsb(SummaryBitboard b) {
+  assert(!b.empty());
+  const int i = __builtin_ctz(b.mask);
+  return Square(64 * i + __builtin_ctzll(b.bb.b[i]));
+}
+
+inline Square msb(SummaryBitboard b) {
+  assert(!b.empty());
+  const int i = 31 ^ __builtin_clz(b.mask);
+  return Square(64 * i + (63 ^ __builtin_clzll(b.bb.b[i])));
+}
+
+inline Square pop_lsb(SummaryBitboard& b) {
+  assert(!b.empty());
+  const int i = __builtin_ctz(b.mask);
+  const Square s = Square(64 * i + __builtin_ctzll(b.bb.b[i]));
+  if (!(b.bb.b[i] &= b.bb.b[i] - 1))
+      b.mask &= b.mask - 1;
+  return s;
+}
+
+} // namespace Stockfish
+
+#endif // #ifndef SUMMARYBB_H_INCLUDED
@@ -0,0 +1,998 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2022 The Stockfish developers (see AUTHORS file)
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "bitboard.h"
+#include "misc.h"
+#include "position.h"
+#include "tablebase.h"
+
+using std::string;
+
+namespace Stockfish {
+
+namespace Tablebases {
+
+int MaxCardinality;
+
+}
+
+namespace {
+
+  constexpr int MaxPieces = 4;
+
+  // Values of a column are stored in blocks of BlockSize consecutive indices
+  constexpr int      BlockBits = 12;
+  constexpr uint64_t BlockSize = 1ULL << BlockBits;
+
+  constexpr char     Magic[8]  = { 'S', 'F', '1', '6', 'T', 'B', '\r', '\n' };
+  constexpr uint32_t Version   = 1;
+  const string       Extension = ".s16tb";
+
+  // A table has four columns, WDL and DTZ for each side to move. A WDL value
+  // is 0 for a loss, 1 for a draw and 2 for a win.
+  enum Column { WDL, DTZ };
+
+  int column(Color stm, Column c) { return 2 * stm + c; }
+
+  // Material lists the pieces of a table in index order: the white king, the
+  // black king, then the other white and black pieces, strongest first. The
+  // stronger side is always white, positions of the other orientation are
+  // probed with the colors swapped.
+  struct Material {
+    int pieces = 0;
+    PieceType type[MaxPieces];
+    Color color[MaxPieces];
+
+    string name() const {
+      string s[COLOR_NB] = { "K", "K" };
+      for (int i = 2; i < pieces; ++i)
+          s[color[i]] += " PNBRQK"[type[i]];
+      return s[WHITE] + "v" + s[BLACK];
+    }
+
+    // The material code identifies a material by its piece counts, see code()
+    uint64_t code(bool swapped) const {
+      uint64_t c = 0;
+      for (int i = 2; i < pieces; ++i)
+          c += 1ULL << (4 * (8 * (color[i] ^ swapped) + type[i]));
+      return c;
+    }
+  };
+
+  uint64_t code(const Position& pos) {
+    uint64_t c = 0;
+    for (Color col : { WHITE, BLACK })
+        c +=  (uint64_t(pos.count<KNIGHT>(col)) << (4 * (8 * col + KNIGHT)))
+            + (uint64_t(pos.count<BISHOP>(col)) << (4 * (8 * col + BISHOP)))
+            + (uint64_t(pos.count<ROOK  >(col)) << (4 * (8 * col + ROOK  )))
+            + (uint64_t(pos.count<QUEEN >(col)) << (4 * (8 * col + QUEEN )));
+    return c;
+  }
+
+  // weaker() orders the sides of a material, by number of pieces then by
+  // the strongest pieces, with each list sorted strongest first
+  bool weaker(const std::vector<PieceType>& a, const std::vector<PieceType>& b) {
+    return a.size() != b.size() ? a.size() < b.size()
+         : std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end());
+  }
+
+  Material make_material(std::vector<PieceType> white, std::vector<PieceType> black, bool* swapped) {
+
+    std::sort(white.begin(), white.end(), std::greater<PieceType>());
+    std::sort(black.begin(), black.end(), std::greater<PieceType>());
+
+    *swapped = weaker(white, black);
+    if (*swapped)
+        std::swap(white, black);
+
+    Material m;
+    m.type[0] = m.type[1] = KING;
+    m.color[0] = WHITE, m.color[1] = BLACK;
+    m.pieces = 2;
+
+    for (PieceType pt : white)
+        m.type[m.pieces] = pt, m.color[m.pieces++] = WHITE;
+    for (PieceType pt : black)
+        m.type[m.pieces] = pt, m.color[m.pieces++] = BLACK;
+
+    return m;
+  }
+
+  // parse_material() reads a material like "KQvK" or "KRvKN". Pawns are not
+  // supported: their tables depend on the promotions and the pawn moves
+  // reset the distance to zeroing within the table itself.
+  bool parse_material(const string& name, Material& m) {
+
+    size_t v = name.find('v');
+    if (v == string::npos || name.size() - 1 > MaxPieces || name[0] != 'K' || name[v + 1] != 'K')
+        return false;
+
+    std::vector<PieceType> side[COLOR_NB];
+    for (size_t i = 1; i < name.size(); ++i)
+    {
+        if (i == v || i == v + 1)
+            continue;
+
+        size_t pt = string("NBRQ").find(name[i]);
+        if (pt == string::npos)
+            return false;
+
+        side[i > v].push_back(PieceType(KNIGHT + pt));
+    }
+
+    bool swapped;
+    m = make_material(side[WHITE], side[BLACK], &swapped);
+    return true;
+  }
+
+  uint64_t table_size(int pieces) { return 64ULL << (8 * (pieces - 1)); }
+
+  // fold() mirrors the position so that the white king is in the a1-h8
+  // quadrant. The four mirror images of a position share its game value.
+  void fold(Square* sq, int pieces) {
+
+    const bool rank = rank_of(sq[0]) > RANK_8, file = file_of(sq[0]) > FILE_H;
+
+    for (int i = 0; i < pieces; ++i)
+    {
+        if (rank)
+            sq[i] = flip_rank(sq[i]);
+        if (file)
+            sq[i] = flip_file(sq[i]);
+    }
+  }
+
+  // encode() returns the index of a folded position: 6 bits for the white
+  // king in its quadrant, then 8 bits per other piece. decode() is the inverse.
+  uint64_t encode(const Square* sq, int pieces) {
+
+    uint64_t idx = (rank_of(sq[0]) << 3) | file_of(sq[0]);
+    for (int i = 1; i < pieces; ++i)
+        idx = (idx << 8) | sq[i];
+    return idx;
+  }
+
+  void decode(uint64_t idx, Square* sq, int pieces) {
+
+    for (int i = pieces - 1; i > 0; --i, idx >>= 8)
+        sq[i] = Square(idx & 0xFF);
+    sq[0] = make_square(File(idx & 7), Rank(idx >> 3));
+  }
+
+
+  // The file starts with a Header, then the Blocks of the four columns, then
+  // the packed values, then 8 bytes of padding so that a value is always read
+  // with a single unaligned 64-bit load.
+  struct Header {
+    char     magic[8];
+    uint32_t version;
+    uint32_t pieces;
+    char     material[16];
+    uint64_t size;     // Positions per side to move
+    uint64_t dataSize; // Bytes of packed values
+  };
+
+  // Block describes BlockSize consecutive values of a column: value i is base
+  // plus the width bits found at bit offset + i * width of the packed values.
+  // A block of equal values, a whole block of draws for instance, takes no
+  // space at all.
+  struct Block {
+    uint64_t offset;
+    uint32_t base;
+    uint32_t width;
+  };
+
+  static_assert(sizeof(Header) == 48 && sizeof(Block) == 16, "Unexpected tablebase header size");
+
+  uint64_t block_count(uint64_t size) { return (size + BlockSize - 1) / BlockSize; }
+
+
+  // Table gives read-only access to a table file, memory-mapped like the book
+  class Table {
+  public:
+    Table() = default;
+    Table(const Table&) = delete;
+    Table& operator=(const Table&) = delete;
+   ~Table();
+
+    bool open(const string& path);
+
+    uint32_t read(int col, uint64_t idx) const {
+
+      const Block& b = blocks[col * blockCount + (idx >> BlockBits)];
+      if (!b.width)
+          return b.base;
+
+      uint64_t bit = b.offset + (idx & (BlockSize - 1)) * b.width, w;
+      std::memcpy(&w, data + bit / 8, sizeof(w));
+      return b.base + uint32_t((w >> (bit % 8)) & ((1ULL << b.width) - 1));
+    }
+
+    // probe() returns the value of the position given by the squares of the
+    // pieces in the order of the material, which are folded in place.
+    uint32_t probe(Square* sq, Color stm, Column c) const {
+      fold(sq, material.pieces);
+      return read(column(stm, c), encode(sq, material.pieces));
+    }
+
+    Material material;
+
+  private:
+    const Block* blocks = nullptr;
+    const uint8_t* data = nullptr;
+    uint64_t blockCount = 0;
+    void* mem = nullptr;
+    size_t mappedSize = 0;
+    std::vector<uint8_t> copy; // Without mmap()
+  };
+
+
+  Table::~Table() {
+
+#ifdef __linux__
+  if (mappedSize)
+      munmap(mem, mappedSize);
+#endif
+  }
+
+
+  bool Table::open(const string& path) {
+
+    const uint8_t* base;
+    size_t size;
+
+#ifdef __linux__
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || size_t(st.st_size) < sizeof(Header))
+    {
+        ::close(fd);
+        return false;
+    }
+
+    mem = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd); // The mapping keeps the file open
+
+    if (mem == MAP_FAILED)
+    {
+        mem = nullptr;
+        return false;
+    }
+
+    madvise(mem, st.st_size, MADV_RANDOM); // Probes jump around, do not read ahead
+    base = static_cast<const uint8_t*>(mem);
+    size = mappedSize = st.st_size;
+#else
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file)
+        return false;
+
+    copy.resize(size_t(file.tellg()));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(copy.data()), copy.size());
+    base = copy.data();
+    size = copy.size();
+#endif
+
+    Header h;
+    if (size < sizeof(Header))
+        return false;
+
+    std::memcpy(&h, base, sizeof(Header));
+    h.material[sizeof(h.material) - 1] = 0;
+
+    if (   std::memcmp(h.magic, Magic, sizeof(Magic))
+        || h.version != Version
+        || !parse_material(h.material, material)
+        || material.name() != h.material
+        || h.pieces != uint32_t(material.pieces)
+        || h.size != table_size(material.pieces))
+        return false;
+
+    blockCount = block_count(h.size);
+    const size_t dataStart = sizeof(Header) + 4 * blockCount * sizeof(Block);
+
+    if (h.dataSize > size || size < dataStart + h.dataSize + 8)
+        return false;
+
+    blocks = reinterpret_cast<const Block*>(base + sizeof(Header));
+
+    // Every block must read its values inside the packed data
+    const uint64_t dataBits = h.dataSize * 8;
+    for (size_t i = 0; i < 4 * blockCount; ++i)
+        if (   blocks[i].width > 32
+            || blocks[i].offset > dataBits
+            || blocks[i].width * BlockSize > dataBits - blocks[i].offset)
+            return false;
+
+    data = base + dataStart;
+    return true;
+  }
+
+
+  // Tables are found by material code, in both orientations. The flag tells
+  // whether the colors of the position must be swapped.
+  std::vector<std::unique_ptr<Table>> TableList;
+  std::unordered_map<uint64_t, std::pair<const Table*, bool>> TableMap;
+
+  void add_table(std::unique_ptr<Table> t) {
+
+    TableMap[t->material.code(true)] = { t.get(), true };
+    TableMap[t->material.code(false)] = { t.get(), false }; // Same code if symmetric
+    Tablebases::MaxCardinality = std::max(Tablebases::MaxCardinality, t->material.pieces);
+    TableList.push_back(std::move(t));
+  }
+
+  const Table* find_table(const Material& m) {
+
+    auto it = TableMap.find(m.code(false));
+    return it != TableMap.end() && !it->second.second ? it->second.first : nullptr;
+  }
+
+  // probe_table() reads a column for the given position, returns false when
+  // there is no table for its material
+  bool probe_table(const Position& pos, Column c, uint32_t& value) {
+
+    if (pos.count<ALL_PIECES>() > Tablebases::MaxCardinality || pos.count<PAWN>())
+        return false;
+
+    auto it = TableMap.find(code(pos));
+    if (it == TableMap.end())
+        return false;
+
+    const Table& t = *it->second.first;
+    const bool swapped = it->second.second;
+    Square sq[MaxPieces];
+    Bitboard remaining = pos.pieces();
+
+    for (int i = 0; i < t.material.pieces; ++i)
+    {
+        Color col = Color(t.material.color[i] ^ swapped);
+        sq[i] = lsb(pos.pieces(col, t.material.type[i]) & remaining);
+        remaining ^= sq[i];
+
+        if (swapped)
+            sq[i] = flip_rank(sq[i]);
+    }
+
+    value = t.probe(sq, Color(pos.side_to_move() ^ swapped), c);
+    return true;
+  }
+
+
+  // State of a position during the generation. A position resolved at
+  // iteration d is lost or won in d plies, lost positions are odd states.
+  enum : uint16_t {
+    UNKNOWN, // Not resolved yet
+    NO_LOSS, // Not resolved yet, but a capture draws
+    INVALID, // Overlapping pieces or the side not to move in check
+    DRAW,
+    RESOLVED
+  };
+
+  constexpr uint16_t win_in(int d)  { return uint16_t(RESOLVED + 2 * d); }
+  constexpr uint16_t loss_in(int d) { return uint16_t(RESOLVED + 2 * d + 1); }
+  constexpr int distance(uint16_t s) { return s >= RESOLVED ? (s - RESOLVED) / 2 : 0; }
+  constexpr bool is_loss(uint16_t s) { return s >= RESOLVED && (s - RESOLVED) % 2; }
+
+  constexpr int MaxDistance = (0xFFFF - RESOLVED) / 2 - 1;
+
+
+  // WorkMemory is the memory of the generator, anonymous memory when it fits
+  // in the budget, else a memory-mapped scratch file, so that the kernel can
+  // write back to disk the pages not in use and tables larger than RAM can be
+  // generated. The scratch file is unlinked at once and never left behind.
+  class WorkMemory {
+  public:
+    WorkMemory(size_t sz, size_t budget, const string& dir) : size(sz) {
+
+#ifdef __linux__
+      if (size > budget)
+      {
+          string path = dir + "/tbgen-" + std::to_string(getpid()) + ".tmp";
+          int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+          if (fd >= 0)
+          {
+              unlink(path.c_str());
+              if (!ftruncate(fd, off_t(size)))
+              {
+                  void* m = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+                  if (m != MAP_FAILED)
+                      mem = m, spilled = true;
+              }
+              ::close(fd);
+          }
+          if (spilled)
+              return;
+      }
+
+      void* m = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      mem = m != MAP_FAILED ? m : nullptr;
+#else
+      (void)budget, (void)dir;
+      mem = std::calloc(1, size);
+#endif
+    }
+
+   ~WorkMemory() {
+#ifdef __linux__
+      if (mem)
+          munmap(mem, size);
+#else
+      std::free(mem);
+#endif
+    }
+
+    uint8_t* data() const { return static_cast<uint8_t*>(mem); }
+
+    void* mem = nullptr;
+    size_t size;
+    bool spilled = false;
+  };
+
+
+  // Generator computes a table by retrograde analysis. Every position is
+  // first examined on its own: checkmates and stalemates are resolved, as
+  // are the captures, which lead to the smaller tables, and the counter of
+  // the position is set to its number of quiet moves. Then iteration d
+  // goes through the positions resolved in d plies and takes back a quiet
+  // move of the side that just moved. The predecessors of a lost position
+  // are won in d + 1 plies; the counters of the predecessors of a won
+  // position are decremented, and a counter reaching zero means a position
+  // where every move loses, lost in d + 1 plies. Positions never resolved
+  // are draws.
+  //
+  // Each iteration scans the table in chunks shared among the threads. The
+  // positions are updated with atomic operations: a won position is only
+  // ever set once, from UNKNOWN or NO_LOSS, and a counter only reaches zero
+  // once, so the result does not depend on the order of the updates.
+  class Generator {
+  public:
+    Generator(const Material& m, size_t threads, size_t budget, const string& dir);
+
+    bool ok() const { return memory.data(); }
+    bool spilled() const { return memory.spilled; }
+    int run();
+    bool write(const string& path) const;
+
+  private:
+    void examine(Color stm, uint64_t idx);
+    void retract(Color stm, uint64_t idx, uint16_t s);
+    uint64_t parallel_for(const std::function<bool(Color, uint64_t)>& f);
+    bool attacked(const Square* sq, Square s, Color by, int skip, Bitboard occupied) const;
+    uint32_t capture_value(const Square* sq, int captured, Color stm) const;
+    uint32_t value(Color stm, Column c, uint64_t idx, uint32_t invalid) const;
+
+    // The table of the material left by the capture of each piece, with the
+    // order of the remaining pieces in it. No table means a bare king draw.
+    struct Capture {
+      const Table* table;
+      bool swapped;
+      int order[MaxPieces];
+    };
+
+    const Material material;
+    const uint64_t size;
+    const size_t threads;
+    WorkMemory memory;
+    uint16_t* state[COLOR_NB];
+    uint8_t* counter[COLOR_NB];
+    Capture captures[MaxPieces];
+  };
+
+
+  Generator::Generator(const Material& m, size_t th, size_t budget, const string& dir)
+    : material(m), size(table_size(m.pieces)), threads(std::max(size_t(1), th)),
+      memory(2 * table_size(m.pieces) * (sizeof(uint16_t) + sizeof(uint8_t)), budget, dir) {
+
+    state[WHITE]   = reinterpret_cast<uint16_t*>(memory.data());
+    state[BLACK]   = state[WHITE] + size;
+    counter[WHITE] = reinterpret_cast<uint8_t*>(state[BLACK] + size);
+    counter[BLACK] = counter[WHITE] + size;
+
+    for (int j = 2; j < material.pieces; ++j)
+    {
+        std::vector<PieceType> side[COLOR_NB];
+        for (int i = 2; i < material.pieces; ++i)
+            if (i != j)
+                side[material.color[i]].push_back(material.type[i]);
+
+        Capture& c = captures[j];
+        Material sub = make_material(side[WHITE], side[BLACK], &c.swapped);
+        c.table = sub.pieces > 2 ? find_table(sub) : nullptr;
+
+        // The pieces keep their order, the two sides are exchanged if swapped
+        int n = 0;
+        for (Color col : { Color(WHITE ^ c.swapped), Color(BLACK ^ c.swapped) })
+            c.order[n++] = col;
+        for (Color col : { Color(WHITE ^ c.swapped), Color(BLACK ^ c.swapped) })
+            for (int i = 2; i < material.pieces; ++i)
+                if (i != j && material.color[i] == col)
+                    c.order[n++] = i;
+    }
+  }
+
+
+  // Generator::parallel_for() calls f on every position of the table, by
+  // chunks of consecutive indices, and returns the number of true results
+  uint64_t Generator::parallel_for(const std::function<bool(Color, uint64_t)>& f) {
+
+    constexpr uint64_t ChunkSize = 1 << 16;
+    const uint64_t chunks = 2 * ((size + ChunkSize - 1) / ChunkSize);
+    std::atomic<uint64_t> next(0), total(0);
+    std::vector<std::thread> workers;
+
+    auto work = [&]() {
+        uint64_t count = 0;
+        for (uint64_t chunk; (chunk = next.fetch_add(1)) < chunks; )
+        {
+            Color stm = Color(chunk % 2);
+            uint64_t first = chunk / 2 * ChunkSize, last = std::min(first + ChunkSize, size);
+            for (uint64_t idx = first; idx < last; ++idx)
+                count += f(stm, idx);
+        }
+        total += count;
+    };
+
+    for (size_t i = 1; i < threads; ++i)
+        workers.emplace_back(work);
+    work();
+
+    for (std::thread& t : workers)
+        t.join();
+
+    return total;
+  }
+
+
+  // Generator::attacked() tells whether square s is attacked by the pieces of
+  // the given color, but the skipped one, given the occupancy
+  bool Generator::attacked(const Square* sq, Square s, Color by, int skip, Bitboard occupied) const {
+
+    for (int i = 0; i < material.pieces; ++i)
+        if (i != skip && material.color[i] == by && nonemptyBB(attacks_bb(material.type[i], sq[i], occupied) & s))
+            return true;
+
+    return false;
+  }
+
+
+  // Generator::capture_value() returns the WDL value, for the side to move,
+  // of the position reached by capturing the given piece
+  uint32_t Generator::capture_value(const Square* sq, int captured, Color stm) const {
+
+    const Capture& c = captures[captured];
+    if (!c.table)
+        return 1;
+
+    Square sub[MaxPieces];
+    for (int i = 0; i < material.pieces - 1; ++i)
+        sub[i] = c.swapped ? flip_rank(sq[c.order[i]]) : sq[c.order[i]];
+
+    return c.table->probe(sub, Color(stm ^ c.swapped), WDL);
+  }
+
+
+  // Generator::examine() sets the initial state and counter of a position
+  void Generator::examine(Color stm, uint64_t idx) {
+
+    const int n = material.pieces;
+    Square sq[MaxPieces];
+    Bitboard occupied = NoSquares, own = NoSquares;
+
+    decode(idx, sq, n);
+
+    for (int i = 0; i < n; ++i)
+    {
+        if (nonemptyBB(occupied & sq[i]))
+        {
+            state[stm][idx] = INVALID;
+            return;
+        }
+        occupied |= sq[i];
+        if (material.color[i] == stm)
+            own |= sq[i];
+    }
+
+    // The kings are the first two pieces, indexed by their color
+    if (attacked(sq, sq[~stm], stm, -1, occupied))
+    {
+        state[stm][idx] = INVALID;
+        return;
+    }
+
+    int legal = 0, quiet = 0;
+    bool win = false, draw = false;
+
+    for (int i = 0; i < n; ++i)
+    {
+        if (material.color[i] != stm)
+            continue;
+
+        Bitboard b = attacks_bb(material.type[i], sq[i], occupied) & ~own;
+        while (nonemptyBB(b))
+        {
+            Square to = pop_lsb(b), from = sq[i];
+            int captured = -1;
+
+            for (int j = 2; j < n; ++j)
+                if (sq[j] == to)
+                    captured = j;
+
+            sq[i] = to;
+
+            if (!attacked(sq, sq[stm], ~stm, captured, (occupied ^ from) | to))
+            {
+                ++legal;
+
+                if (captured < 0)
+                    ++quiet;
+                else
+                {
+                    uint32_t v = capture_value(sq, captured, ~stm);
+                    win  |= v == 0;
+                    draw |= v == 1;
+                }
+            }
+            sq[i] = from;
+        }
+    }
+
+    counter[stm][idx] = uint8_t(quiet);
+    state[stm][idx] = !legal ? (attacked(sq, sq[stm], ~stm, -1, occupied) ? loss_in(0) : uint16_t(DRAW))
+                    : win    ? win_in(1)
+                    : !quiet ? (draw ? uint16_t(DRAW) : loss_in(1))
+                    : draw   ? uint16_t(NO_LOSS) : uint16_t(UNKNOWN);
+  }
+
+
+  // Generator::retract() updates the predecessors of a position resolved
+  // with state s, the positions before a quiet move of the side not to move
+  void Generator::retract(Color stm, uint64_t idx, uint16_t s) {
+
+    const int n = material.pieces;
+    const Color us = ~stm;
+    const int d = distance(s) + 1;
+    Square sq[MaxPieces], prev[MaxPieces];
+    Bitboard occupied = NoSquares;
+
+    decode(idx, sq, n);
+
+    for (int i = 0; i < n; ++i)
+        occupied |= sq[i];
+
+    for (int i = 0; i < n; ++i)
+    {
+        if (material.color[i] != us)
+            continue;
+
+        Bitboard b = attacks_bb(material.type[i], sq[i], occupied) & ~occupied;
+        while (nonemptyBB(b))
+        {
+            std::copy(sq, sq + n, prev);
+            prev[i] = pop_lsb(b);
+            fold(prev, n);
+
+            const uint64_t p = encode(prev, n);
+            uint16_t* ps = &state[us][p];
+            uint16_t expected = __atomic_load_n(ps, __ATOMIC_RELAXED);
+
+            if (expected != UNKNOWN && expected != NO_LOSS)
+                continue;
+
+            if (is_loss(s))
+            {
+                // A move to a lost position wins, whatever the other moves
+                while (   (expected == UNKNOWN || expected == NO_LOSS)
+                       && !__atomic_compare_exchange_n(ps, &expected, win_in(d), false,
+                                                       __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {}
+            }
+            else if (   !__atomic_sub_fetch(&counter[us][p], 1, __ATOMIC_RELAXED)
+                     && expected == UNKNOWN)
+            {
+                // Every quiet move loses and no capture draws or wins. The
+                // compare-exchange fails if a concurrent update won it.
+                __atomic_compare_exchange_n(ps, &expected, loss_in(d), false,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+            }
+        }
+    }
+  }
+
+
+  // Generator::run() computes the table and returns the longest distance
+  int Generator::run() {
+
+    parallel_for([&](Color stm, uint64_t idx) { examine(stm, idx); return false; });
+
+    int d = 0;
+    for ( ; d < MaxDistance; ++d)
+    {
+        const uint16_t win = win_in(d), loss = loss_in(d);
+
+        uint64_t resolved = parallel_for([&](Color stm, uint64_t idx) {
+            uint16_t s = __atomic_load_n(&state[stm][idx], __ATOMIC_RELAXED);
+            if (s != win && s != loss)
+                return false;
+            retract(stm, idx, s);
+            return true;
+        });
+
+        // Positions are resolved in 0 and 1 plies before the first iteration
+        if (!resolved && d > 0)
+            break;
+    }
+
+    parallel_for([&](Color stm, uint64_t idx) {
+        uint16_t& s = state[stm][idx];
+        if (s == UNKNOWN || s == NO_LOSS)
+            s = DRAW;
+        return false;
+    });
+
+    return d - 1;
+  }
+
+
+  // Generator::value() returns the value to store for a position, or the
+  // given one for an invalid position, which can then take any value
+  uint32_t Generator::value(Color stm, Column c, uint64_t idx, uint32_t invalid) const {
+
+    const uint16_t s = state[stm][idx];
+
+    return s == INVALID ? invalid
+         : c == DTZ     ? uint32_t(distance(s))
+         : s == DRAW    ? 1 : is_loss(s) ? 0 : 2;
+  }
+
+
+  // Generator::write() packs the columns block by block. The invalid positions
+  // take the smallest value of their block so that they widen nothing.
+  bool Generator::write(const string& path) const {
+
+    const uint64_t blocks = block_count(size);
+    std::vector<Block> index(4 * blocks);
+    uint64_t bits = 0;
+
+    for (Color stm : { WHITE, BLACK })
+        for (Column c : { WDL, DTZ })
+            for (uint64_t b = 0; b < blocks; ++b)
+            {
+                uint32_t lo = 0xFFFFFFFF, hi = 0;
+                for (uint64_t idx = b * BlockSize; idx < std::min(size, (b + 1) * BlockSize); ++idx)
+                    if (state[stm][idx] != INVALID)
+                    {
+                        uint32_t v = value(stm, c, idx, 0);
+                        lo = std::min(lo, v), hi = std::max(hi, v);
+                    }
+
+                Block& blk = index[column(stm, c) * blocks + b];
+                blk.base = lo > hi ? 0 : lo;
+                blk.width = lo >= hi ? 0 : 32 - __builtin_clz(hi - lo);
+                blk.offset = bits;
+                bits += blk.width * BlockSize;
+            }
+
+    Header h = {};
+    std::memcpy(h.magic, Magic, sizeof(Magic));
+    h.version = Version;
+    h.pieces = material.pieces;
+    std::strncpy(h.material, material.name().c_str(), sizeof(h.material) - 1);
+    h.size = size;
+    h.dataSize = (bits + 7) / 8;
+
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    file.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(Block));
+
+    // Values are appended to a 64-bit accumulator, least significant first
+    uint64_t acc = 0;
+    int filled = 0;
+
+    auto put = [&](uint64_t v, int width) {
+        acc |= v << filled;
+        filled += width;
+        if (filled >= 64)
+        {
+            file.write(reinterpret_cast<const char*>(&acc), sizeof(acc));
+            filled -= 64;
+            acc = filled ? v >> (width - filled) : 0;
+        }
+    };
+
+    for (Color stm : { WHITE, BLACK })
+        for (Column c : { WDL, DTZ })
+            for (uint64_t b = 0; b < blocks; ++b)
+            {
+                const Block& blk = index[column(stm, c) * blocks + b];
+                if (!blk.width)
+                    continue;
+
+                for (uint64_t idx = b * BlockSize; idx < (b + 1) * BlockSize; ++idx)
+                    put(idx < size ? value(stm, c, idx, blk.base) - blk.base : 0, blk.width);
+            }
+
+    // The last partial word, then the padding for the 64-bit reads
+    file.write(reinterpret_cast<const char*>(&acc), (filled + 7) / 8);
+    const uint64_t zero = 0;
+    file.write(reinterpret_cast<const char*>(&zero), sizeof(zero));
+
+    return bool(file);
+  }
+
+} // namespace
+
+
+namespace Tablebases {
+
+/// Tablebases::init() loads the tables found in the given directories,
+/// separated by ':' like Stockfish's SyzygyPath. Previous tables are dropped.
+
+void init(const string& paths) {
+
+  TableMap.clear();
+  TableList.clear();
+  MaxCardinality = 0;
+
+#ifdef __linux__
+  std::istringstream ss(paths);
+  string dirPath;
+
+  while (std::getline(ss, dirPath, ':'))
+      if (DIR* dir = opendir(dirPath.c_str()))
+      {
+          while (dirent* entry = readdir(dir))
+          {
+              string name = entry->d_name;
+              if (   name.size() <= Extension.size()
+                  || name.compare(name.size() - Extension.size(), Extension.size(), Extension))
+                  continue;
+
+              auto t = std::make_unique<Table>();
+              if (t->open(dirPath + "/" + name))
+                  add_table(std::move(t));
+          }
+          closedir(dir);
+      }
+#else
+  (void)paths;
+#endif
+}
+
+
+/// Tablebases::probe_wdl() returns the game value of the position for the side
+/// to move. Sets result to FAIL, returning a draw, when there is no table.
+
+WDLScore probe_wdl(const Position& pos, ProbeState* result) {
+
+  uint32_t v;
+  *result = probe_table(pos, WDL, v) ? OK : FAIL;
+  return *result == OK ? WDLScore(int(v) - 1) : WDLDraw;
+}
+
+
+/// Tablebases::probe_dtz() returns the number of plies to the next capture or
+/// to the mate under perfect play, positive when the side to move wins and
+/// negative when it loses. It is 0 for a draw, and for a checkmate, which
+/// probe_wdl() tells apart.
+
+int probe_dtz(const Position& pos, ProbeState* result) {
+
+  uint32_t wdl, dtz;
+  *result = probe_table(pos, WDL, wdl) && probe_table(pos, DTZ, dtz) ? OK : FAIL;
+  return *result == FAIL || wdl == 1 ? 0 : wdl == 2 ? int(dtz) : -int(dtz);
+}
+
+
+/// Tablebases::generate() writes the table of the given material to dir, first
+/// generating the missing tables reached by a capture. The work memory takes
+/// 6 bytes per position pair, 25 MB for 3 pieces and 6.4 GB for 4: beyond memoryMb
+/// it is a scratch file in dir, paged in and out by the kernel.
+
+bool generate(const string& name, const string& dir,
+              size_t threads, size_t memoryMb, std::ostream& log) {
+
+  Material m;
+  if (!parse_material(name, m))
+  {
+      log << "Unsupported material " << name << ", expected up to " << MaxPieces
+          << " pieces without pawns, e.g. KQvK or KRvKN" << std::endl;
+      return false;
+  }
+
+  if (find_table(m))
+  {
+      log << m.name() << " already loaded" << std::endl;
+      return true;
+  }
+
+  // The tables reached by a capture come first
+  for (int j = 2; j < m.pieces; ++j)
+  {
+      std::vector<PieceType> side[COLOR_NB];
+      for (int i = 2; i < m.pieces; ++i)
+          if (i != j)
+              side[m.color[i]].push_back(m.type[i]);
+
+      bool swapped;
+      Material sub = make_material(side[WHITE], side[BLACK], &swapped);
+      if (sub.pieces > 2 && !find_table(sub) && !generate(sub.name(), dir, threads, memoryMb, log))
+          return false;
+  }
+
+  const string path = dir + "/" + m.name() + Extension;
+  TimePoint start = now();
+
+  Generator gen(m, threads, memoryMb * 1024 * 1024, dir);
+  if (!gen.ok())
+  {
+      log << "Cannot allocate the work memory of " << m.name() << std::endl;
+      return false;
+  }
+
+  log << m.name() << ": " << 2 * table_size(m.pieces) << " positions, "
+      << threads << " thread(s)" << (gen.spilled() ? ", spilling to disk" : "") << std::endl;
+
+  int longest = gen.run();
+  TimePoint generated = now();
+
+  if (!gen.write(path))
+  {
+      log << "Cannot write " << path << std::endl;
+      return false;
+  }
+
+  auto t = std::make_unique<Table>();
+  if (!t->open(path))
+  {
+      log << "Cannot load " << path << std::endl;
+      return false;
+  }
+  add_table(std::move(t));
+
+  std::ifstream written(path, std::ios::binary | std::ios::ate);
+  log << m.name() << ": longest win " << longest << " plies, generated in "
+      << generated - start << " ms, written in " << now() - generated << " ms, "
+      << size_t(written.tellg()) / 1024 << " KB" << std::endl;
+
+  return true;
+}
+
+} // namespace Tablebases
+
+} // namespace Stockfish
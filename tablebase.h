@@ -0,0 +1,68 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2022 The Stockfish developers (see AUTHORS file)
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef TABLEBASE_H_INCLUDED
+#define TABLEBASE_H_INCLUDED
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+
+#include "types.h"
+
+namespace Stockfish {
+
+class Position;
+
+/// Tablebases namespace holds the endgame tablebases: a retrograde generator
+/// for small pawnless material sets and the probing code. A table stores, for
+/// each position of its material with either side to move, the game value
+/// (WDL) and the distance in plies to the next zeroing move (DTZ) under
+/// perfect play, a capture or the mate. The 50-move rule is ignored.
+///
+/// Positions are indexed with the white king folded into the a1-h8 quadrant
+/// by flip_rank() and flip_file(), which divides the size of a table by four.
+/// Tables are stored compressed, in blocks of consecutive indices packed with
+/// the fewest bits that hold the values of the block, and memory-mapped on
+/// load: a probe is an index computation and a single bit-field read.
+
+namespace Tablebases {
+
+enum WDLScore {
+  WDLLoss = -1, // Loss
+  WDLDraw =  0, // Draw
+  WDLWin  =  1  // Win
+};
+
+enum ProbeState {
+  FAIL = 0, // Probe failed (missing file table)
+  OK   = 1  // Probe successful
+};
+
+extern int MaxCardinality;
+
+void init(const std::string& paths);
+WDLScore probe_wdl(const Position& pos, ProbeState* result);
+int probe_dtz(const Position& pos, ProbeState* result);
+
+bool generate(const std::string& material, const std::string& dir,
+              size_t threads, size_t memoryMb, std::ostream& log);
+
+} // namespace Tablebases
+
+} // namespace Stockfish
+
+#endif // #ifndef TABLEBASE_H_INCLUDED
@@ -0,0 +1,106 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2022 The Stockfish developers (see AUTHORS file)
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <algorithm>
+#include <cassert>
+
+#include "numa.h"
+#include "thread.h"
+
+namespace Stockfish {
+
+/// ThreadPool::set() stops the current workers, once the queued jobs are
+/// done, and starts threadCount new ones. With threadCount 0 the pool is
+/// only torn down.
+
+void ThreadPool::set(size_t threadCount, size_t queueCapacity) {
+
+  {
+      std::unique_lock<std::mutex> lk(mutex);
+      exit = true;
+  }
+  jobReady.notify_all();
+
+  for (std::thread& th : threads)
+      th.join();
+
+  threads.clear();
+  exit = false;
+  capacity = std::max(size_t(1), queueCapacity);
+
+  for (size_t idx = 0; idx < threadCount; ++idx)
+      threads.emplace_back(&ThreadPool::idle_loop, this, idx);
+}
+
+
+/// ThreadPool::submit() queues a job, waiting for room in the queue first
+
+void ThreadPool::submit(Job job) {
+
+  assert(!threads.empty());
+
+  std::unique_lock<std::mutex> lk(mutex);
+  spaceReady.wait(lk, [&]{ return queue.size() < capacity; });
+  queue.push_back(std::move(job));
+  lk.unlock();
+
+  jobReady.notify_one();
+}
+
+
+/// ThreadPool::wait_for_idle() returns once every submitted job has run
+
+void ThreadPool::wait_for_idle() {
+
+  std::unique_lock<std::mutex> lk(mutex);
+  idle.wait(lk, [&]{ return queue.empty() && !running; });
+}
+
+
+/// ThreadPool::idle_loop() is where the workers wait for jobs. The queue is
+/// drained before the workers exit.
+
+void ThreadPool::idle_loop(size_t idx) {
+
+  Numa::bind_this_thread(idx);
+
+  while (true)
+  {
+      std::unique_lock<std::mutex> lk(mutex);
+      jobReady.wait(lk, [&]{ return exit || !queue.empty(); });
+
+      if (queue.empty())
+          return;
+
+      Job job = std::move(queue.front());
+      queue.pop_front();
+      ++running;
+      lk.unlock();
+      spaceReady.notify_one();
+
+      job();
+
+      lk.lock();
+      --running;
+      bool done = queue.empty() && !running;
+      lk.unlock();
+
+      if (done)
+          idle.notify_all();
+  }
+}
+
+} // namespace Stockfish
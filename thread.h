@@ -0,0 +1,64 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2022 The Stockfish developers (see AUTHORS file)
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef THREAD_H_INCLUDED
+#define THREAD_H_INCLUDED
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Stockfish {
+
+/// ThreadPool runs jobs on a fixed set of worker threads, each one bound to
+/// a NUMA node with Numa::bind_this_thread(). The queue of waiting jobs is
+/// bounded: submit() blocks while it is full, so that a producer reading
+/// requests faster than they are served stops reading instead of growing
+/// the queue without limit.
+
+class ThreadPool {
+public:
+  using Job = std::function<void()>;
+
+  ThreadPool() = default;
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+ ~ThreadPool() { set(0, 0); }
+
+  void set(size_t threadCount, size_t queueCapacity);
+  void submit(Job job);
+  void wait_for_idle();
+  size_t size() const { return threads.size(); }
+
+private:
+  void idle_loop(size_t idx);
+
+  std::vector<std::thread> threads;
+  std::deque<Job> queue;
+  size_t capacity = 0;
+  size_t running = 0;
+  bool exit = false;
+  std::mutex mutex;
+  std::condition_variable jobReady, spaceReady, idle;
+};
+
+} // namespace Stockfish
+
+#endif // #ifndef THREAD_H_INCLUDED
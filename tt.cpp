@@ -0,0 +1,469 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2022 The Stockfish developers (see AUTHORS file)
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>   // For std::memset
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "numa.h"
+#include "tt.h"
+
+using std::string;
+
+namespace Stockfish {
+
+TranspositionTable TT; // Our global transposition table
+
+namespace {
+
+  // A snapshot file starts with SnapshotHeader, padded to DataOffset so that
+  // the clusters are page aligned in the mapping. Version must be bumped when
+  // the entry layout or the Zobrist keys change, older files are then refused.
+  constexpr char     Magic[8]   = { '1', '6', 'x', '1', '6', 'T', 'T', '\0' };
+  constexpr uint32_t Version    = 1;
+  constexpr size_t   DataOffset = 4096;
+  constexpr uint64_t Seed       = 0x243F6A8885A308D3ULL;
+
+  struct SnapshotHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t clusterBytes;
+    uint64_t clusterCount;
+    uint64_t checksum;       // Of the clusters
+    uint32_t clusterSize;    // Entries per cluster
+    uint8_t  generation;
+    uint8_t  padding[19];
+    uint64_t headerChecksum; // Of the bytes above
+  };
+
+  static_assert(sizeof(SnapshotHeader) == 64, "Unexpected SnapshotHeader size");
+
+  // checksum() hashes size bytes, a multiple of 8, continuing from h
+  uint64_t checksum(const void* data, size_t size, uint64_t h) {
+
+    const char* p = static_cast<const char*>(data);
+
+    for (size_t i = 0; i < size; i += 8)
+    {
+        uint64_t w;
+        std::memcpy(&w, p + i, 8);
+        h = (h ^ w) * 0x9E3779B97F4A7C15ULL;
+        h ^= h >> 29;
+    }
+    return h;
+  }
+
+  uint64_t header_checksum(const SnapshotHeader& h) {
+    return checksum(&h, offsetof(SnapshotHeader, headerChecksum), Seed);
+  }
+
+  void unmap_snapshot(void* mem, size_t size) {
+#ifdef __linux__
+    munmap(mem, size);
+#else
+    (void)size;
+    std::free(mem);
+#endif
+  }
+
+  // map_snapshot() maps a whole snapshot file, copy-on-write when the table
+  // is to live in it, and checks the header against the file and the given
+  // cluster layout. Returns nullptr, after printing the reason, on failure.
+  void* map_snapshot(const string& path, bool forTable, size_t clusterBytes,
+                     size_t clusterSize, size_t& size) {
+
+    void* mem = nullptr;
+    size = 0;
+
+#ifdef __linux__
+    int fd = ::open(path.c_str(), O_RDONLY);
+    struct stat st;
+
+    if (fd >= 0 && fstat(fd, &st) == 0 && size_t(st.st_size) >= DataOffset)
+    {
+        size = size_t(st.st_size);
+        mem = mmap(nullptr, size, forTable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (mem == MAP_FAILED)
+            mem = nullptr;
+        else // Probes jump around the table, a merge reads it once in order
+            madvise(mem, size, forTable ? MADV_RANDOM : MADV_SEQUENTIAL);
+    }
+
+    if (fd >= 0)
+        ::close(fd); // The mapping keeps the file open
+#else
+    (void)forTable;
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+
+    if (file && size_t(file.tellg()) >= DataOffset)
+    {
+        size = size_t(file.tellg());
+        mem = std::malloc(size);
+        file.seekg(0);
+        if (mem && !file.read(static_cast<char*>(mem), size))
+            std::free(mem), mem = nullptr;
+    }
+#endif
+
+    if (!mem)
+    {
+        std::cerr << "Cannot read hash file " << path << std::endl;
+        return nullptr;
+    }
+
+    const SnapshotHeader& h = *static_cast<const SnapshotHeader*>(mem);
+    const char* error =  std::memcmp(h.magic, Magic, sizeof(Magic)) ? "not a hash file"
+                       : h.version != Version                        ? "unsupported version"
+                       : h.headerChecksum != header_checksum(h)      ? "corrupted header"
+                       : h.clusterBytes != clusterBytes
+                      || h.clusterSize != clusterSize                ? "different entry layout"
+                       : h.clusterCount == 0
+                      || size != DataOffset + h.clusterCount * clusterBytes ? "truncated file"
+                       : nullptr;
+    if (error)
+    {
+        std::cerr << "Hash file " << path << ": " << error << std::endl;
+        unmap_snapshot(mem, size);
+        return nullptr;
+    }
+
+    return mem;
+  }
+
+} // namespace
+
+/// TTEntry::save() populates the TTEntry with a new node's data, possibly
+/// overwriting an old position. Update is not atomic and can be racy.
+
+void TTEntry::save(Key k, Value v, bool pv, Bound b, Depth d, Move m, Value ev) {
+
+  // Preserve any existing move for the same position
+  if (m || (uint16_t)k != key16)
+      move32 = (uint32_t)m;
+
+  // Overwrite less valuable entries (cheapest checks first)
+  if (   b == BOUND_EXACT
+      || (uint16_t)k != key16
+      || d - DEPTH_OFFSET > depth8 - 4)
+  {
+      assert(d > DEPTH_OFFSET);
+      assert(d < 256 + DEPTH_OFFSET);
+
+      key16     = (uint16_t)k;
+      depth8    = (uint8_t)(d - DEPTH_OFFSET);
+      genBound8 = (uint8_t)(TT.generation8 | uint8_t(pv) << 2 | b);
+      value16   = (int16_t)v;
+      eval16    = (int16_t)ev;
+  }
+}
+
+
+TranspositionTable::~TranspositionTable() {
+
+  free_table();
+}
+
+
+/// TranspositionTable::free_table() releases the table, either allocated by
+/// resize() or mapped by load().
+
+void TranspositionTable::free_table() {
+
+  if (snapshot)
+      unmap_snapshot(snapshot, snapshotSize);
+  else
+      Numa::free_interleaved(table, clusterCount * sizeof(Cluster));
+
+  table = nullptr;
+  snapshot = nullptr;
+  clusterCount = snapshotSize = 0;
+}
+
+
+/// TranspositionTable::resize() sets the size of the transposition table,
+/// measured in megabytes. Transposition table consists of a power of 2 number
+/// of clusters and each cluster consists of ClusterSize number of TTEntry.
+
+void TranspositionTable::resize(size_t mbSize) {
+
+  free_table();
+
+  clusterCount = mbSize * 1024 * 1024 / sizeof(Cluster);
+  table = static_cast<Cluster*>(Numa::alloc_interleaved(clusterCount * sizeof(Cluster)));
+
+  if (!table)
+  {
+      std::cerr << "Failed to allocate " << mbSize
+                << "MB for transposition table." << std::endl;
+      exit(EXIT_FAILURE);
+  }
+
+  clear();
+}
+
+
+/// TranspositionTable::clear() initializes the entire transposition table to zero,
+/// in a multi-threaded way.
+
+void TranspositionTable::clear() {
+
+  std::vector<std::thread> threads;
+  const size_t threadCount = std::max(1U, std::thread::hardware_concurrency());
+
+  for (size_t idx = 0; idx < threadCount; ++idx)
+  {
+      threads.emplace_back([this, idx, threadCount]() {
+
+          // Each thread will zero its part of the hash table
+          const size_t stride = size_t(clusterCount / threadCount),
+                       start  = size_t(stride * idx),
+                       len    = idx != threadCount - 1 ?
+                                stride : clusterCount - start;
+
+          std::memset(&table[start], 0, len * sizeof(Cluster));
+      });
+  }
+
+  for (std::thread& th : threads)
+      th.join();
+
+  generation8 = 0;
+}
+
+
+/// TranspositionTable::save() writes the table to a snapshot file. The file
+/// is written under a temporary name then renamed, so that a table mapped
+/// from the same path is never changed under it. The clusters are copied by
+/// chunks before they are hashed and written, so the checksum matches the
+/// file even while searches keep writing to the table.
+
+bool TranspositionTable::save(const string& path) const {
+
+  if (!clusterCount)
+      return false;
+
+  const string tmp = path + ".tmp";
+  std::ofstream file(tmp, std::ios::binary);
+  std::vector<char> header(DataOffset);
+  std::vector<Cluster> chunk(std::min(clusterCount, size_t(1) << 14));
+  uint64_t sum = Seed;
+
+  file.write(header.data(), DataOffset); // Written last, with the checksum
+
+  for (size_t i = 0; file && i < clusterCount; i += chunk.size())
+  {
+      const size_t bytes = std::min(chunk.size(), clusterCount - i) * sizeof(Cluster);
+
+      std::memcpy(chunk.data(), &table[i], bytes);
+      sum = checksum(chunk.data(), bytes, sum);
+      file.write(reinterpret_cast<const char*>(chunk.data()), bytes);
+  }
+
+  SnapshotHeader h = {};
+  std::memcpy(h.magic, Magic, sizeof(Magic));
+  h.version      = Version;
+  h.clusterBytes = sizeof(Cluster);
+  h.clusterCount = clusterCount;
+  h.checksum     = sum;
+  h.clusterSize  = ClusterSize;
+  h.generation   = generation8;
+  h.headerChecksum = header_checksum(h);
+
+  file.seekp(0);
+  file.write(reinterpret_cast<const char*>(&h), sizeof(h));
+  file.close();
+
+  if (!file || std::rename(tmp.c_str(), path.c_str()))
+  {
+      std::remove(tmp.c_str());
+      std::cerr << "Cannot write hash file " << path << std::endl;
+      return false;
+  }
+
+  return true;
+}
+
+
+/// TranspositionTable::load() replaces the table with the one of a snapshot
+/// file, mapped copy-on-write. The header is always checked, the checksum
+/// of the clusters only with verify, as it reads the whole file. Returns
+/// false, leaving the table unchanged, if the file cannot be used.
+
+bool TranspositionTable::load(const string& path, bool verify) {
+
+  size_t size;
+  void* mem = map_snapshot(path, true, sizeof(Cluster), ClusterSize, size);
+  if (!mem)
+      return false;
+
+  const SnapshotHeader& h = *static_cast<const SnapshotHeader*>(mem);
+  Cluster* clusters = reinterpret_cast<Cluster*>(static_cast<char*>(mem) + DataOffset);
+
+  if (verify && checksum(clusters, h.clusterCount * sizeof(Cluster), Seed) != h.checksum)
+  {
+      std::cerr << "Hash file " << path << ": checksum mismatch" << std::endl;
+      unmap_snapshot(mem, size);
+      return false;
+  }
+
+  free_table();
+
+  table = clusters;
+  clusterCount = size_t(h.clusterCount);
+  generation8 = h.generation;
+  snapshot = mem;
+  snapshotSize = size;
+  return true;
+}
+
+
+/// TranspositionTable::merge() adds the entries of a snapshot file to the
+/// table, which must have the same number of clusters: entries only keep 16
+/// bits of their key, so they cannot move to another cluster. The entries
+/// keep their age relative to the generation of their own table. An entry
+/// of the file replaces an entry of the same position if it is deeper, and
+/// otherwise the least valuable entry of the cluster, as in probe(), if it
+/// is more valuable. Returns false, leaving the table unchanged, on failure.
+
+bool TranspositionTable::merge(const string& path) {
+
+  size_t size;
+  const void* mem = map_snapshot(path, false, sizeof(Cluster), ClusterSize, size);
+  if (!mem)
+      return false;
+
+  const SnapshotHeader& h = *static_cast<const SnapshotHeader*>(mem);
+  const Cluster* other = reinterpret_cast<const Cluster*>(static_cast<const char*>(mem) + DataOffset);
+  const char* error =  h.clusterCount != clusterCount ? "different table size"
+                     : checksum(other, clusterCount * sizeof(Cluster), Seed) != h.checksum ? "checksum mismatch"
+                     : nullptr;
+  if (error)
+  {
+      std::cerr << "Hash file " << path << ": " << error << std::endl;
+      unmap_snapshot(const_cast<void*>(mem), size);
+      return false;
+  }
+
+  auto worth = [&](const TTEntry& e) {
+      return e.depth8 - ((GENERATION_CYCLE + generation8 - e.genBound8) & GENERATION_MASK);
+  };
+
+  for (size_t i = 0; i < clusterCount; ++i)
+      for (TTEntry e : other[i].entry)
+      {
+          if (!e.depth8)
+              continue;
+
+          const int age = (GENERATION_CYCLE + h.generation - e.genBound8) & GENERATION_MASK;
+          e.genBound8 = uint8_t(((generation8 - age) & GENERATION_MASK) | (e.genBound8 & (GENERATION_DELTA - 1)));
+
+          TTEntry* const tte = table[i].entry;
+          TTEntry* replace = tte;
+
+          for (int j = 0; j < ClusterSize; ++j)
+              if (tte[j].key16 == e.key16 || !tte[j].depth8)
+              {
+                  replace = &tte[j];
+                  break;
+              }
+              else if (worth(tte[j]) < worth(*replace))
+                  replace = &tte[j];
+
+          const bool same = replace->key16 == e.key16 || !replace->depth8;
+
+          if (same ? e.depth8 > replace->depth8 : worth(e) > worth(*replace))
+              *replace = e;
+          else if (same && !replace->move32)
+              replace->move32 = e.move32;
+      }
+
+  unmap_snapshot(const_cast<void*>(mem), size);
+  return true;
+}
+
+
+/// TranspositionTable::probe() looks up the current position in the transposition
+/// table. It returns true and a pointer to the TTEntry if the position is found.
+/// Otherwise, it returns false and a pointer to an empty or least valuable TTEntry
+/// to be replaced later. The replace value of an entry is calculated as its depth
+/// minus 8 times its relative age. TTEntry t1 is considered more valuable than
+/// TTEntry t2 if its replace value is greater than that of t2.
+
+TTEntry* TranspositionTable::probe(const Key key, bool& found) const {
+
+  INSTRUMENT_COUNT(TT_PROBES);
+
+  TTEntry* const tte = first_entry(key);
+  const uint16_t key16 = (uint16_t)key;  // Use the low 16 bits as key inside the cluster
+
+  for (int i = 0; i < ClusterSize; ++i)
+      if (tte[i].key16 == key16 || !tte[i].depth8)
+      {
+          tte[i].genBound8 = uint8_t(generation8 | (tte[i].genBound8 & (GENERATION_DELTA - 1))); // Refresh
+
+          found = (bool)tte[i].depth8;
+          if (found)
+              INSTRUMENT_COUNT(TT_HITS);
+          return &tte[i];
+      }
+
+  // Find an entry to be replaced according to the replacement strategy
+  TTEntry* replace = tte;
+  for (int i = 1; i < ClusterSize; ++i)
+      // Due to our packed storage format for generation and its cyclic
+      // nature we add GENERATION_CYCLE (256 is the modulus, plus what
+      // is needed to keep the unrelated lowest n bits from affecting
+      // the result) to calculate the entry age correctly even after
+      // generation8 overflows into the next cycle.
+      if (  replace->depth8 - ((GENERATION_CYCLE + generation8 - replace->genBound8) & GENERATION_MASK)
+          >   tte[i].depth8 - ((GENERATION_CYCLE + generation8 -   tte[i].genBound8) & GENERATION_MASK))
+          replace = &tte[i];
+
+  return found = false, replace;
+}
+
+
+/// TranspositionTable::hashfull() returns an approximation of the hashtable
+/// occupation during a search. The hash is x permill full, as per UCI protocol.
+
+int TranspositionTable::hashfull() const {
+
+  // A loaded table may hold fewer than the 1000 sampled clusters
+  const size_t samples = std::min<size_t>(1000, clusterCount);
+
+  int cnt = 0;
+  for (size_t i = 0; i < samples; ++i)
+      for (int j = 0; j < ClusterSize; ++j)
+          cnt += table[i].entry[j].depth8 && (table[i].entry[j].genBound8 & GENERATION_MASK) == generation8;
+
+  return samples ? int(cnt * 1000 / (samples * ClusterSize)) : 0;
+}
+
+} // namespace Stockfish
@@ -21,140 +21,156 @@
 #include <cstdint>
 #include <cstdlib>
 #include <algorithm>
+#include <type_traits>
+#include <utility>
 
 namespace Stockfish
 {
 
-constexpr int MAX_MOVES = 256; // what if this isn't enough? used in movegen.h
+constexpr int MAX_MOVES = 1024; // 32 pieces a side on 256 squares exceed 256 moves, used in movegen.h
 constexpr int MAX_PLY   = 246;
 
 using Key = uint64_t;
 
-struct Bitboard {
-    uint64_t b[4];
-
-    constexpr Bitboard auxForRightShift(unsigned int bits) const {
-        assert(bits < 64);
-        Bitboard bb = {.b = {b[0], b[1], b[2], b[3]}};
-        if (bits == 0) return bb;
-        unsigned int nn = 64 - bits;
-        uint64_t mask = ~0 >> nn;
-        uint64_t r = b[1] & mask;
-        bb.b[0] = (b[0] >> bits) | (r << nn);
-        r = b[2] & mask;
-        bb.b[1] = (b[1] >> bits) | (r << nn);
-        r = b[3] & mask;
-        bb.b[2] = (b[2] >> bits) | (r << nn);
-        bb.b[3] >>= bits;
-        return bb;
+/// WideBitboard is a bitboard of N 64-bit words, least significant first, for
+/// boards of more than 128 squares: bit i of word w is square 64 * w + i.
+/// Narrower boards use a single integer word instead, see BitboardWord.
+
+template<int N>
+struct WideBitboard {
+    uint64_t b[N];
+
+    /// generate() builds a bitboard from f(i), the value of word i. The words
+    /// are a pack expansion, unrolled whatever the optimizer decides.
+    template<typename F, size_t... I>
+    __attribute__((always_inline)) static constexpr WideBitboard generate(F f, std::index_sequence<I...>) {
+        return {.b = {f(I)...}};
     }
 
-    constexpr Bitboard operator >> (unsigned int bits) const {
-        Bitboard t = auxForRightShift(bits & 0x3F);
-        if (bits >= 256)
-            return {.b = {0, 0, 0, 0}};
-        if (bits >= 192)
-            return {.b = {t.b[3], 0, 0, 0}};
-        if (bits >= 128)
-            return {.b = {t.b[2], t.b[3], 0, 0}};
-        if (bits >= 64)
-            return {.b = {t.b[1], t.b[2], t.b[3], 0}};
-        return t;
-    };
-
-    constexpr Bitboard auxForLeftShift(unsigned int bits) const {
-        assert(bits <= 64);
-        Bitboard bb = {.b = {b[0], b[1], b[2], b[3]}};
-        if (bits == 0) return bb;
-        unsigned int nn = 64 - bits;
-        uint64_t mask = ~0 << nn;
-        uint64_t r = b[1] & mask;
-        bb.b[0] = (b[0] << bits) | (r >> nn);
-        r = b[2] & mask;
-        bb.b[1] = (b[1] << bits) | (r >> nn);
-        r = b[3] & mask;
-        bb.b[2] = (b[2] << bits) | (r >> nn);
-        bb.b[3] <<= bits;
-        return bb;
+    template<typename F>
+    __attribute__((always_inline)) static constexpr WideBitboard generate(F f) {
+        return generate(f, std::make_index_sequence<N>());
     }
 
-    constexpr Bitboard operator << (unsigned int bits) const {
-        Bitboard t = auxForLeftShift(bits & 0x3F);
-        if (bits >= 256)
-            return {.b = {0, 0, 0, 0}};
-        if (bits >= 192)
-            return {.b = {0, 0, 0, t.b[0]}};
-        if (bits >= 128)
-            return {.b = {0, 0, t.b[0], t.b[1]}};
-        if (bits >= 64)
-            return {.b = {0, t.b[0], t.b[1], t.b[2]}};
-        return t;
-    };
-
-    inline Bitboard& operator |=(const Bitboard x) {
-        b[0] |= x.b[0];
-        b[1] |= x.b[1];
-        b[2] |= x.b[2];
-        b[3] |= x.b[3];
-        return *this;
+    __attribute__((always_inline)) constexpr WideBitboard operator >> (unsigned int bits) const {
+        const int w = int(bits / 64), s = int(bits % 64);
+        return generate([&](int i) __attribute__((always_inline)) {
+            return  (i + w     < N ? b[i + w] >> s : 0)
+                  | (i + w + 1 < N && s ? b[i + w + 1] << (64 - s) : 0);
+        });
     }
-    inline Bitboard& operator &=(const Bitboard x) {
-        b[0] &= x.b[0];
-        b[1] &= x.b[1];
-        b[2] &= x.b[2];
-        b[3] &= x.b[3];
-        return *this;
+
+    __attribute__((always_inline)) constexpr WideBitboard operator << (unsigned int bits) const {
+        const int w = int(bits / 64), s = int(bits % 64);
+        return generate([&](int i) __attribute__((always_inline)) {
+            return  (i - w     >= 0 ? b[i - w] << s : 0)
+                  | (i - w - 1 >= 0 && s ? b[i - w - 1] >> (64 - s) : 0);
+        });
     }
-    inline Bitboard& operator ^=(const Bitboard x) {
-        b[0] ^= x.b[0];
-        b[1] ^= x.b[1];
-        b[2] ^= x.b[2];
-        b[3] ^= x.b[3];
-        return *this;
+
+    /// shl<Bits>() and shr<Bits>() shift by a constant. The source words and
+    /// the bit offsets are then template arguments, so that each word is one
+    /// or two shifts and an OR, with no branch and no loop left to unroll.
+    template<int Bits>
+    __attribute__((always_inline)) constexpr WideBitboard shl() const {
+        return shl<Bits>(std::make_index_sequence<N>());
     }
 
-    constexpr Bitboard operator ~ () const {
-        return {.b {~b[0], ~b[1], ~b[2], ~b[3]}};
+    template<int Bits>
+    __attribute__((always_inline)) constexpr WideBitboard shr() const {
+        return shr<Bits>(std::make_index_sequence<N>());
     }
-};
 
-constexpr inline Bitboard operator |(const Bitboard x, const Bitboard y) {
-    return {.b {x.b[0] | y.b[0], x.b[1] | y.b[1], x.b[2] | y.b[2], x.b[3] | y.b[3]}};
-}
-constexpr inline Bitboard operator &(const Bitboard x, const Bitboard y) {
-    return {.b {x.b[0] & y.b[0], x.b[1] & y.b[1], x.b[2] & y.b[2], x.b[3] & y.b[3]}};
-}
-constexpr inline Bitboard operator ^(const Bitboard x, const Bitboard y) {
-    return {.b {x.b[0] ^ y.b[0], x.b[1] ^ y.b[1], x.b[2] ^ y.b[2], x.b[3] ^ y.b[3]}};
-}
+    inline WideBitboard& operator |=(const WideBitboard x) { return *this = *this | x; }
+    inline WideBitboard& operator &=(const WideBitboard x) { return *this = *this & x; }
+    inline WideBitboard& operator ^=(const WideBitboard x) { return *this = *this ^ x; }
 
-constexpr inline bool operator ==(const Bitboard x, const Bitboard y) {
-    return (x.b[0] == y.b[0]) && (x.b[1] == y.b[1]) && (x.b[2] == y.b[2]) && (x.b[3] == y.b[3]);
-}
+    constexpr WideBitboard operator ~ () const {
+        return generate([&](int i) { return ~b[i]; });
+    }
 
-constexpr inline bool operator !=(const Bitboard x, const Bitboard y) {
-    return !(x == y);
-}
+    friend constexpr WideBitboard operator |(const WideBitboard x, const WideBitboard y) {
+        return generate([&](int i) { return x.b[i] | y.b[i]; });
+    }
+    friend constexpr WideBitboard operator &(const WideBitboard x, const WideBitboard y) {
+        return generate([&](int i) { return x.b[i] & y.b[i]; });
+    }
+    friend constexpr WideBitboard operator ^(const WideBitboard x, const WideBitboard y) {
+        return generate([&](int i) { return x.b[i] ^ y.b[i]; });
+    }
+
+    template<int Bits, size_t... I>
+    __attribute__((always_inline)) constexpr WideBitboard shl(std::index_sequence<I...>) const {
+        return {.b = {shl_word<Bits, int(I)>()...}};
+    }
+
+    template<int Bits, size_t... I>
+    __attribute__((always_inline)) constexpr WideBitboard shr(std::index_sequence<I...>) const {
+        return {.b = {shr_word<Bits, int(I)>()...}};
+    }
+
+    template<int Bits, int I>
+    __attribute__((always_inline)) constexpr uint64_t shl_word() const {
+        constexpr int W = Bits / 64, S = Bits % 64;
+        uint64_t r = 0;
+        if constexpr (I - W >= 0)
+            r = b[I - W] << S;
+        if constexpr (S && I - W - 1 >= 0)
+            r |= b[I - W - 1] >> (64 - S);
+        return r;
+    }
+
+    template<int Bits, int I>
+    __attribute__((always_inline)) constexpr uint64_t shr_word() const {
+        constexpr int W = Bits / 64, S = Bits % 64;
+        uint64_t r = 0;
+        if constexpr (I + W < N)
+            r = b[I + W] >> S;
+        if constexpr (S && I + W + 1 < N)
+            r |= b[I + W + 1] << (64 - S);
+        return r;
+    }
+
+    template<size_t... I>
+    static constexpr bool equal(const WideBitboard x, const WideBitboard y, std::index_sequence<I...>) {
+        return ((x.b[I] == y.b[I]) && ...);
+    }
+
+    friend constexpr bool operator ==(const WideBitboard x, const WideBitboard y) {
+        return equal(x, y, std::make_index_sequence<N>());
+    }
+    friend constexpr bool operator !=(const WideBitboard x, const WideBitboard y) {
+        return !(x == y);
+    }
+};
 
-inline Bitboard operator *(const Bitboard x, const Bitboard y) {
-    uint64_t w[8] = {0, 0, 0, 0, 0, 0, 0, 0};
-    uint64_t xx[8] = {(uint32_t)x.b[0], x.b[0]>>32, (uint32_t)x.b[1], x.b[1]>>32, (uint32_t)x.b[2], x.b[2]>>32, (uint32_t)x.b[3], x.b[3]>>32};
-    uint64_t yy[8] = {(uint32_t)y.b[0], y.b[0]>>32, (uint32_t)y.b[1], y.b[1]>>32, (uint32_t)y.b[2], y.b[2]>>32, (uint32_t)y.b[3], y.b[3]>>32};
-    for (int i = 0; i <= 7; i++) {
+template<int N>
+inline WideBitboard<N> operator *(const WideBitboard<N> x, const WideBitboard<N> y) {
+    uint64_t w[2 * N] = {}, xx[2 * N], yy[2 * N];
+    for (int i = 0; i < N; ++i)
+    {
+        xx[2 * i] = uint32_t(x.b[i]), xx[2 * i + 1] = x.b[i] >> 32;
+        yy[2 * i] = uint32_t(y.b[i]), yy[2 * i + 1] = y.b[i] >> 32;
+    }
+    for (int i = 0; i < 2 * N; i++) {
         uint64_t k = 0ULL;
-        for (int j = 0; j <= 7-i; j++) {
+        for (int j = 0; j < 2 * N - i; j++) {
             uint64_t t = xx[i] * yy[j] + w[i+j] + k;
             w[i+j] = (uint32_t)t;
             k = t >> 32;
         }
     }
-    return {.b {w[0] | (w[1] << 32), w[2] | (w[3] << 32), w[4] | (w[5] << 32), w[6] | (w[7] << 32)}};
+    WideBitboard<N> r = {};
+    for (int i = 0; i < N; ++i)
+        r.b[i] = w[2 * i] | (w[2 * i + 1] << 32);
+    return r;
 }
 
-constexpr Bitboard operator - (const Bitboard x, const Bitboard y) {
-    Bitboard result = {.b = {0,0,0,0}};
+template<int N>
+constexpr WideBitboard<N> operator - (const WideBitboard<N> x, const WideBitboard<N> y) {
+    WideBitboard<N> result = {};
     uint64_t borrow = 0;
-    for(int i = 0; i < 4; ++i) {
+    for(int i = 0; i < N; ++i) {
         if(x.b[i] >= y.b[i] + borrow) {
             result.b[i] = x.b[i] - y.b[i] - borrow;
             borrow = 0;
@@ -166,6 +182,22 @@ constexpr Bitboard operator - (const Bitboard x, const Bitboard y) {
     return result;
 }
 
+/// BitboardWord is the narrowest type holding a bitboard of the given number
+/// of squares: uint64_t up to 8x8, unsigned __int128 up to 10x10 (or 8x16),
+/// else as many 64-bit words as needed, three for 12x12.
+
+template<int Squares>
+using BitboardWord = std::conditional_t<Squares <= 64,  uint64_t,
+                     std::conditional_t<Squares <= 128, unsigned __int128,
+                                                        WideBitboard<(Squares + 63) / 64>>>;
+
+/// The board of the engine, the default instantiation of Geometry (see
+/// geometry.h). Square, File, Rank and Direction below are its named values.
+
+constexpr int BOARD_FILES = 16;
+constexpr int BOARD_RANKS = 16;
+
+using Bitboard = BitboardWord<BOARD_FILES * BOARD_RANKS>;
 
 /// A move needs 19 (three bytes?) bits to be stored
 ///
@@ -194,6 +226,13 @@ enum Color {
   WHITE, BLACK, COLOR_NB = 2
 };
 
+enum Bound {
+  BOUND_NONE,
+  BOUND_UPPER,
+  BOUND_LOWER,
+  BOUND_EXACT = BOUND_UPPER | BOUND_LOWER
+};
+
 enum Value : int {
   VALUE_ZERO      = 0,
   VALUE_DRAW      = 0,
@@ -219,6 +258,20 @@ enum Value : int {
   MidgameLimit  = 15258, EndgameLimit  = 3915
 };
 
+using Depth = int;
+
+enum : int {
+  DEPTH_QS     =  0,
+  DEPTH_NONE   = -6,
+  DEPTH_OFFSET = -7 // value used only for TT entry occupancy check
+};
+
+enum Phase {
+  PHASE_ENDGAME,
+  PHASE_MIDGAME = 128,
+  MG = 0, EG = 1, PHASE_NB = 2
+};
+
 enum PieceType {
   NO_PIECE_TYPE, PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING,
   ALL_PIECES = 0,
@@ -232,6 +285,13 @@ enum Piece {
   PIECE_NB = 16
 };
 
+constexpr Value PieceValue[PHASE_NB][PIECE_NB] = {
+  { VALUE_ZERO, PawnValueMg, KnightValueMg, BishopValueMg, RookValueMg, QueenValueMg, VALUE_ZERO, VALUE_ZERO,
+    VALUE_ZERO, PawnValueMg, KnightValueMg, BishopValueMg, RookValueMg, QueenValueMg, VALUE_ZERO, VALUE_ZERO },
+  { VALUE_ZERO, PawnValueEg, KnightValueEg, BishopValueEg, RookValueEg, QueenValueEg, VALUE_ZERO, VALUE_ZERO,
+    VALUE_ZERO, PawnValueEg, KnightValueEg, BishopValueEg, RookValueEg, QueenValueEg, VALUE_ZERO, VALUE_ZERO }
+};
+
 enum Square : int {
   SQ_A1,  SQ_B1,  SQ_C1,  SQ_D1,  SQ_E1,  SQ_F1,  SQ_G1,  SQ_H1,  SQ_I1,  SQ_J1,  SQ_K1,  SQ_L1,  SQ_M1,  SQ_N1,  SQ_O1,  SQ_P1,
   SQ_A2,  SQ_B2,  SQ_C2,  SQ_D2,  SQ_E2,  SQ_F2,  SQ_G2,  SQ_H2,  SQ_I2,  SQ_J2,  SQ_K2,  SQ_L2,  SQ_M2,  SQ_N2,  SQ_O2,  SQ_P2,
@@ -334,8 +394,11 @@ constexpr int operator/(T d1, T d2) { return int(d1) / int(d2); }  \
 inline T& operator*=(T& d, int i) { return d = T(int(d) * i); }    \
 inline T& operator/=(T& d, int i) { return d = T(int(d) / i); }
 
+ENABLE_FULL_OPERATORS_ON(Value)
 ENABLE_FULL_OPERATORS_ON(Direction)
 
+ENABLE_BASE_OPERATORS_ON(Score)
+
 ENABLE_INCR_OPERATORS_ON(Piece)
 ENABLE_INCR_OPERATORS_ON(PieceType)
 ENABLE_INCR_OPERATORS_ON(Square)
@@ -346,6 +409,27 @@ ENABLE_INCR_OPERATORS_ON(Rank)
 #undef ENABLE_INCR_OPERATORS_ON
 #undef ENABLE_BASE_OPERATORS_ON
 
+/// Only declared but not defined. We don't want to multiply two scores due to
+/// a very high risk of overflow. So user should explicitly convert to integer.
+Score operator*(Score, Score) = delete;
+
+/// Division of a Score must be handled separately for each term
+inline Score operator/(Score s, int i) {
+  return make_score(mg_value(s) / i, eg_value(s) / i);
+}
+
+/// Multiplication of a Score by an integer. We check for overflow in debug mode.
+inline Score operator*(Score s, int i) {
+
+  Score result = Score(int(s) * i);
+
+  assert(eg_value(result) == (i * eg_value(s)));
+  assert(mg_value(result) == (i * mg_value(s)));
+  assert((i == 0) || (result / i) == s);
+
+  return result;
+}
+
 constexpr Square operator+(Square s, Direction d) { return Square(int(s) + int(d)); }
 constexpr Square operator-(Square s, Direction d) { return Square(int(s) - int(d)); }
 inline Square& operator+=(Square& s, Direction d) { return s = s + d; }
@@ -367,6 +451,14 @@ constexpr Piece operator~(Piece pc) {
   return Piece(pc ^ 8); // Swap color of piece B_KNIGHT <-> W_KNIGHT
 }
 
+constexpr Value mate_in(int ply) {
+  return VALUE_MATE - ply;
+}
+
+constexpr Value mated_in(int ply) {
+  return -VALUE_MATE + ply;
+}
+
 constexpr Square make_square(File f, Rank r) {
   return Square((r << 4) + f);
 }
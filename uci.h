@@ -0,0 +1,44 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2022 The Stockfish developers (see AUTHORS file)
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef UCI_H_INCLUDED
+#define UCI_H_INCLUDED
+
+#include <string>
+
+#include "types.h"
+
+namespace Stockfish {
+
+class Position;
+
+/// UCI namespace converts moves, squares and scores to and from the text
+/// notation of the protocols. Squares take two or three characters, e.g.
+/// "a1" or "p16", and a move is the origin and destination squares followed
+/// by the promotion piece, if any, e.g. "c15c16q".
+
+namespace UCI {
+
+std::string value(Value v);
+std::string square(Square s);
+std::string move(Move m);
+Move to_move(const Position& pos, std::string& str);
+
+} // namespace UCI
+
+} // namespace Stockfish
+
+#endif // #ifndef UCI_H_INCLUDED